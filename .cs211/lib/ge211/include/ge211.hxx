@@ -9,6 +9,8 @@ namespace ge211 {}
 #include "ge211_event.hxx"
 #include "ge211_geometry.hxx"
 #include "ge211_audio.hxx"
+#include "ge211_parallel.hxx"
+#include "ge211_profile.hxx"
 #include "ge211_resource.hxx"
 #include "ge211_random.hxx"
 #include "ge211_sprites.hxx"
@@ -7,6 +7,7 @@
 #include "ge211_forward.hxx"
 #include "ge211_geometry.hxx"
 #include "ge211_noexcept.hxx"
+#include "ge211_profile.hxx"
 #include "ge211_random.hxx"
 #include "ge211_resource.hxx"
 #include "ge211_session.hxx"
@@ -14,6 +15,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace ge211 {
 
@@ -150,6 +152,10 @@ public:
     /// function.
     static const Dims<int> default_window_dimensions;
 
+    /// The usual frame rate, in frames per second, when the renderer can't
+    /// synchronize with the display.
+    static const double default_frame_rate;
+
     /// Polymorphic classes should have virtual destructors.
     virtual ~Abstract_game() {}
 
@@ -210,7 +216,8 @@ protected:
     /// Called by the game engine after initializing the game but before
     /// commencing the event loop. You can do this to perform initialization
     /// tasks such as preparing sprites::Sprite%s with
-    /// prepare(const Sprite&) const.
+    /// prepare(const Sprite&) const, or queuing them with
+    /// warm_up(const Sprite&).
     virtual void on_start() { }
 
     /// Called by the game engine after exiting the event loop but before
@@ -225,6 +232,24 @@ protected:
     /// errors.
     virtual void on_quit() { }
 
+    /// Override this function to let the engine sleep while the game has
+    /// nothing to do. Normally the engine runs a frame (on_frame(double),
+    /// draw(Sprite_set&), and so on) 60 times a second, whether or not
+    /// anything changes. If this returns `true` after a frame, the engine
+    /// instead waits until an input or window event arrives, or until
+    /// idle_timeout() const passes, before running the next frame.
+    ///
+    /// Return `true` only when the next frame would draw exactly what the
+    /// last one did unless an event arrives: no animation in progress, and
+    /// no timer about to go off sooner than idle_timeout() const. The
+    /// default is never to be idle.
+    virtual bool is_idle() const { return false; }
+
+    /// While the game is idle (see is_idle() const), how long the engine
+    /// waits for an event before running a frame anyway. Override this to
+    /// wake up in time for a timer. The default is one second.
+    virtual Duration idle_timeout() const { return Duration(1); }
+
     /// Override this function to specify the initial dimensions of the
     /// game's window.
     /// This is only called by the engine once at startup.
@@ -277,6 +302,17 @@ protected:
     double get_load_percent() const NOEXCEPT
     { return load_; }
 
+    /// Gets the record of how long each phase of the most recent frames
+    /// took, which can be used to find out whether slow frames come from
+    /// the game itself or from rendering. See profile::Frame_timing.
+    profile::Frame_timing& frame_timing() NOEXCEPT
+    { return frame_timing_; }
+
+    /// Gets the record of how long each phase of the most recent frames
+    /// took.
+    const profile::Frame_timing& frame_timing() const NOEXCEPT
+    { return frame_timing_; }
+
     /// Prepares a sprites::Sprite for rendering, without actually including it
     /// in the scene. The first time a sprites::Sprite is rendered, it ordinarily
     /// has to be converted and transferred to video memory. This function
@@ -288,6 +324,26 @@ protected:
     /// function.
     void prepare(const sprites::Sprite&) const;
 
+    /// Queues a sprites::Sprite to be prepared, as by
+    /// prepare(const Sprite&) const, before the next frame is drawn.
+    /// Unlike prepare(const Sprite&) const, this can be called before the
+    /// engine starts, such as from your game's constructor.
+    ///
+    /// If @ref warm_up_budget is zero (the default), everything queued is
+    /// prepared at once. Otherwise, queued sprites are prepared in the
+    /// order they were queued, before each frame's draw(Sprite_set&), until
+    /// the frame has spent @ref warm_up_budget on them; so warming up a
+    /// large set of sprites from on_start() is spread across the first few
+    /// frames rather than holding up the first one. A sprite drawn before
+    /// its turn just gets prepared when it is first drawn, as usual.
+    ///
+    /// The sprite must live until it has been prepared.
+    void warm_up(const sprites::Sprite&);
+
+    /// How many sprites queued by warm_up(const Sprite&) are waiting to be
+    /// prepared.
+    size_t warm_up_remaining() const NOEXCEPT;
+
     ///@}
 
     /// Assign this member variable to change the window's background color
@@ -295,14 +351,44 @@ protected:
     /// your overridden on_start() and/or draw(Sprite_set&) functions.
     Color background_color = default_background_color;
 
+    /// The most frames per second to run while the window doesn't have
+    /// the keyboard focus. Slowing down in the background leaves the CPU
+    /// and GPU to whatever the user is doing instead; since
+    /// on_frame(double) is passed the real length of each frame, games
+    /// that animate by time still keep time. If this is 0, no frames run
+    /// at all until an event arrives (such as the window getting the focus
+    /// back). The default is @ref default_frame_rate, which is to say no
+    /// slower than usual. The usual place to assign this variable is your
+    /// overridden on_start() function.
+    double unfocused_frame_rate = default_frame_rate;
+
+    /// Like @ref unfocused_frame_rate, but for while the window is
+    /// minimized or otherwise hidden. Nothing is drawn while the window is
+    /// hidden, however fast frames run.
+    double hidden_frame_rate = default_frame_rate;
+
+    /// How much time each frame may spend preparing sprites queued by
+    /// warm_up(const Sprite&), or zero to prepare them all before the next
+    /// frame. At least one queued sprite is prepared each frame. The time
+    /// counts toward the Frame_phase::draw phase.
+    Duration warm_up_budget;
+
 private:
     friend class detail::Engine;
 
     void mark_present_() NOEXCEPT;
     void mark_frame_() NOEXCEPT;
+    // Like mark_frame_(), for a frame that ended by waiting while idle.
+    // The next on_frame(double) is told the frame took `nominal` rather
+    // than however long the wait was, so an animation started by the
+    // event that ended the wait doesn't jump ahead.
+    void mark_idle_frame_(Duration nominal) NOEXCEPT;
 
     void poll_channels_();
 
+    // Prepares sprites queued by warm_up() until warm_up_budget is spent.
+    void warm_up_step_();
+
     detail::Session session_;
     detail::lazy_ptr<Mixer> mixer_;
     detail::Engine* engine_ = nullptr;
@@ -318,6 +404,11 @@ private:
     int            sample_counter_ {0};
     Timer          real_time_;
     Pausable_timer busy_time_;
+
+    profile::Frame_timing frame_timing_;
+
+    std::vector<const sprites::Sprite*> warm_up_queue_;
+    size_t warm_up_next_ = 0;
 };
 
 }
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ge211_noexcept.hxx"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ge211 {
+
+namespace detail {
+
+// The resource bundle format, shared by the library, which reads bundles,
+// and the `ge211_bundle` tool, which writes them.
+//
+// A bundle is a single file holding many resource files, so that they can
+// all be found with one open and one mmap. It starts with a header:
+//
+//     magic           8 bytes, bundle_magic
+//     count           u64, the number of resources
+//
+// followed by `count` index entries, sorted by name hash:
+//
+//     name_hash       u64, bundle_hash of the name
+//     name_offset     u64, where the name is, from the start of the file
+//     name_size       u64, its length in bytes (not NUL-terminated)
+//     offset          u64, where the contents are
+//     size            u64, their length in bytes
+//
+// and then the names and contents. Every u64 is little-endian.
+
+static const char bundle_magic[8] = {'G', 'E', '2', '1', '1', 'B', 'N', '1'};
+
+// The default filename for a bundle, which the library looks for next to
+// the executable and then in the working directory.
+static const char bundle_filename[] = "resources.ge211";
+
+static const size_t bundle_header_size = 16;
+static const size_t bundle_entry_fields = 5;
+static const size_t bundle_entry_size = 8 * bundle_entry_fields;
+
+// 64-bit FNV-1a.
+inline uint64_t bundle_hash(const char* name, size_t size) NOEXCEPT
+{
+    uint64_t hash = 0xcbf29ce484222325u;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= uint8_t(name[i]);
+        hash *= 0x100000001b3u;
+    }
+
+    return hash;
+}
+
+} // end namespace detail
+
+}
@@ -5,6 +5,8 @@
 #include "ge211_render.hxx"
 #include "ge211_window.hxx"
 
+#include <vector>
+
 namespace ge211 {
 
 namespace detail {
@@ -23,11 +25,21 @@ public:
 private:
     void handle_events_(SDL_Event&);
     void paint_sprites_(Sprite_set&);
+    // Fills paint_order_ with the sprites of the set from back to front:
+    // by z, and in the order they were added for the same z.
+    void sort_sprites_(const Sprite_set&);
 
     Abstract_game& game_;
     Window window_;
     detail::Renderer renderer_;
     bool is_focused_ = false;
+    // Minimized or otherwise hidden.
+    bool is_hidden_ = false;
+
+    // Scratch space for sort_sprites_, kept so that painting doesn't
+    // allocate once these have grown to fit a frame.
+    std::vector<const Placed_sprite*> paint_order_;
+    std::vector<size_t> z_counts_;
 };
 
 } // end namespace detail
@@ -131,6 +131,7 @@ class Host_error : public Environment_error
     friend ::ge211::internal::Render_sprite;
     friend class detail::Renderer;
     friend class detail::Texture;
+    friend class detail::Glyph_atlas;
 };
 
 /// Indicates an error opening a file.
@@ -152,8 +153,9 @@ class Font_error final : public Host_error
     explicit Font_error(const std::string& message);
     static Font_error could_not_load(const std::string& filename);
 
-    /// Thrower
+    /// Throwers
     friend Font;
+    friend class detail::Font_lease;
 };
 
 /// Indicates an error loading an image from an already-open file.
@@ -212,6 +214,9 @@ public:
     /// Changes the log level of this logger.
     void level(Log_level level) NOEXCEPT { level_ = level; }
 
+    /// Will messages at the given level be printed?
+    bool enabled(Log_level level) const NOEXCEPT { return level >= level_; }
+
     /// Returns the one and only logger instance.
     static Logger& instance() NOEXCEPT;
 
@@ -223,6 +228,16 @@ private:
 
 /// A Log_message accumulates information and then prints it all at
 /// once when it's about to be destroyed.
+///
+/// A message below the Logger's level is inactive: it allocates
+/// nothing, and appending to it does nothing. Its arguments are still
+/// evaluated, though, so for messages that are expensive to build, use
+/// @ref GE211_LOG, which skips them entirely.
+///
+/// Messages are printed to `std::cerr` by a background thread, so that
+/// printing never holds up the caller. Fatal messages are the exception:
+/// they are printed right away, after any messages still waiting. Use
+/// flush() to wait for everything logged so far to be printed.
 class Log_message
 {
 public:
@@ -239,7 +254,7 @@ public:
     template <typename STREAM_INSERTABLE>
     Log_message& operator<<(STREAM_INSERTABLE const& value)
     {
-        if (active_) message_ << value;
+        if (message_) *message_ << value;
         return *this;
     }
 
@@ -265,8 +280,9 @@ public:
 
 private:
     std::string reason_;
-    std::ostringstream message_;
-    bool active_;
+    // Null if this message is inactive.
+    std::unique_ptr<std::ostringstream> message_;
+    Log_level level_;
 };
 
 /// Returns a debug-level log message.
@@ -281,6 +297,9 @@ Log_message warn(std::string reason = "");
 /// Returns a fatal-level log message.
 Log_message fatal(std::string reason = "");
 
+/// Waits until every message logged so far has been printed.
+void flush();
+
 } // end namespace logging
 
 } // end namespace internal
@@ -299,3 +318,19 @@ Log_message fatal_sdl();
 } // end namespace detail
 
 }
+
+/// Starts a log message at the given level (`debug`, `info`, `warn` or
+/// `fatal`), to append to with `<<`. Unlike calling the function of the
+/// same name, if the level is disabled then nothing after the macro is
+/// evaluated at all, so building the message costs nothing.
+///
+/// \example
+///
+/// ```
+/// GE211_LOG(debug) << "Board: " << expensive_to_string(board);
+/// ```
+#define GE211_LOG(LEVEL)                                                  \
+    if (!::ge211::internal::logging::Logger::instance().enabled(          \
+            ::ge211::internal::logging::Log_level::LEVEL))                \
+        { }                                                               \
+    else ::ge211::internal::logging::LEVEL()
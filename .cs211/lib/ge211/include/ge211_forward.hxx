@@ -73,14 +73,27 @@ class Transform;
 
 } // end namespace geometry.
 
+namespace profile {
+
+enum class Frame_phase;
+class Frame_timing;
+class Trace_scope;
+struct Texture_usage;
+class Tracer;
+
+} // end namespace profile
+
 namespace sprites {
 
 class Sprite;
 
 class Circle_sprite;
+class Glyph_text_sprite;
 class Image_sprite;
 class Multiplexed_sprite;
 class Rectangle_sprite;
+class Solid_rectangle_sprite;
+class Sprite_atlas;
 class Text_sprite;
 
 } // end namespace sprites
@@ -118,6 +131,9 @@ namespace detail {
 
 class Engine;
 class File_resource;
+class Font_handles;
+class Font_lease;
+class Glyph_atlas;
 struct Placed_sprite;
 class Renderer;
 class Session;
@@ -136,6 +152,7 @@ using namespace audio;
 using namespace events;
 using namespace exceptions;
 using namespace geometry;
+using namespace profile;
 using namespace sprites;
 using namespace time;
 
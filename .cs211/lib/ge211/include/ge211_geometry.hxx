@@ -660,6 +660,7 @@ private:
     friend Circle_sprite;
     friend ::ge211::internal::Render_sprite;
     friend class detail::Renderer;
+    friend class detail::Glyph_atlas;
 
     /// Converts this rectangle to an internal SDL rectangle.
     operator SDL_Rect() const
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ge211_forward.hxx"
+
+#include <cstddef>
+#include <functional>
+
+namespace ge211 {
+
+/// Calls `job(0)`, `job(1)`, and so on up to `job(count - 1)`, spread
+/// across a pool of worker threads and the calling thread, and returns
+/// once every call has returned. The pool has a thread for each core but
+/// one, and is started the first time it's needed.
+///
+/// This is meant for making sprites, which takes a while when there are
+/// many of them: the pixels are drawn when the sprite is made, and only
+/// sent to the graphics card (on the main thread) when it's first drawn or
+/// prepared. A job may make or reconfigure Text_sprite%s, Image_sprite%s,
+/// Rectangle_sprite%s and Circle_sprite%s, and load resource files. It
+/// must not touch anything to do with the window or rendering, including
+/// Glyph_text_sprite, Sprite_atlas, Sprite_set and the game itself.
+///
+/// If jobs throw, the first exception is rethrown once all jobs have
+/// finished. Calling parallel_for() from a job runs the inner jobs on
+/// that job's thread.
+///
+/// \example
+///
+/// ```
+/// std::vector<ge211::Text_sprite> labels(names.size());
+///
+/// ge211::parallel_for(labels.size(), [&](size_t i) {
+///     labels[i].reconfigure(ge211::Text_sprite::Builder(font)
+///                                   << names[i]);
+/// });
+/// ```
+void parallel_for(size_t count, std::function<void(size_t)> const& job);
+
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "ge211_forward.hxx"
+#include "ge211_noexcept.hxx"
+#include "ge211_time.hxx"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ge211 {
+
+/// Facilities for finding out where the time goes.
+namespace profile {
+
+/// The parts of a frame that the engine times, in the order they happen.
+///
+/// \sa Frame_timing
+enum class Frame_phase
+{
+    /// Handling input and window events, including the `on_key` and
+    /// `on_mouse` handlers.
+    events,
+    /// Abstract_game::on_frame(double).
+    on_frame,
+    /// Checking on the audio mixer.
+    poll_channels,
+    /// Abstract_game::draw(Sprite_set&), and before it, preparing sprites
+    /// queued with Abstract_game::warm_up(const Sprite&).
+    draw,
+    /// Clearing the window and rendering the sprites.
+    paint,
+    /// Sending the finished frame to the display. With vsync, this is
+    /// usually where the engine waits for the display to be ready.
+    present,
+    /// Waiting for the next frame to start: software vsync, background
+    /// throttling, and waiting while the game is idle.
+    sleep,
+};
+
+/// How long each phase of the most recent frames took. The engine keeps
+/// one of these for each game, and records every frame in it; get it
+/// with Abstract_game::frame_timing().
+///
+/// Only the last @ref capacity frames are kept, in fixed ring buffers,
+/// so recording a frame doesn't allocate and costs a few clock reads. To
+/// find where a hitch came from, compare the percentiles of the phases:
+/// a slow `draw` is the game, a slow `paint` or `present` is rendering.
+///
+/// \example
+///
+/// ```
+/// void My_game::on_key(ge211::Key key)
+/// {
+///     using ge211::Frame_phase;
+///
+///     if (key == ge211::Key::code('t')) {
+///         auto const& timing = frame_timing();
+///         std::cerr << "draw p99: "
+///                   << timing.percentile(Frame_phase::draw, 99).seconds()
+///                   << " s, over budget: "
+///                   << timing.over_budget_count() << "\n";
+///     }
+/// }
+/// ```
+class Frame_timing
+{
+public:
+    /// How many of the most recent frames are kept.
+    static const size_t capacity = 256;
+
+    /// The number of members of Frame_phase.
+    static const size_t phase_count = 7;
+
+    /// Constructs an empty record, with a budget of 1/60 s.
+    Frame_timing() NOEXCEPT;
+
+    /// How many frames are recorded, at most @ref capacity.
+    size_t frame_count() const NOEXCEPT;
+
+    /// How long the given phase took in the most recent frame, or zero if
+    /// no frames have been recorded.
+    Duration last(Frame_phase) const NOEXCEPT;
+
+    /// The given percentile, from 0 to 100, of how long the given phase
+    /// took over the recorded frames. For example, `percentile(phase, 50)`
+    /// is the median, and `percentile(phase, 100)` the slowest. Returns
+    /// zero if no frames have been recorded.
+    Duration percentile(Frame_phase, double percent) const;
+
+    /// Like percentile(Frame_phase, double) const, but for the whole frame,
+    /// not including the sleep phase: that is, the time spent working.
+    Duration work_percentile(double percent) const;
+
+    /// The most time a frame can spend working (that is, in every phase
+    /// but sleep) before it counts as over budget.
+    Duration budget() const NOEXCEPT;
+
+    /// Changes the budget. This does not recount frames already recorded.
+    void set_budget(Duration) NOEXCEPT;
+
+    /// How many frames have gone over budget since the game started (or
+    /// reset() was called), including frames no longer recorded.
+    long over_budget_count() const NOEXCEPT;
+
+    /// How many frames have been recorded since the game started (or
+    /// reset() was called), including frames no longer recorded.
+    long total_frame_count() const NOEXCEPT;
+
+    /// Forgets all recorded frames and counts.
+    void reset() NOEXCEPT;
+
+private:
+    friend class detail::Engine;
+
+    // Starts timing a frame, beginning with its first phase.
+    void start_frame_() NOEXCEPT;
+    // Ends the given phase, which is timed from the end of the previous
+    // phase (or the start of the frame).
+    void end_phase_(Frame_phase) NOEXCEPT;
+    // Ends the sleep phase, and with it the frame.
+    void end_frame_() NOEXCEPT;
+
+    // The times for each phase of the current frame go in column next_,
+    // in seconds. Floats keep the whole record to a few kilobytes.
+    float samples_[phase_count][capacity];
+    size_t next_;
+    size_t count_;
+
+    Duration budget_;
+    long over_budget_;
+    long total_;
+
+    Time_point frame_start_;
+    Time_point phase_start_;
+};
+
+/// How many textures ge211 currently has, and roughly how much video
+/// memory they take up.
+struct Texture_usage
+{
+    /// The number of textures.
+    long count;
+    /// Their total size in bytes, at 4 bytes per pixel.
+    long bytes;
+};
+
+/// Returns how many textures ge211 currently has, and how big they are.
+/// This counts every texture: sprites that have been rendered or
+/// prepared, glyph atlases, and Sprite_atlas sheets.
+Texture_usage texture_usage() NOEXCEPT;
+
+/// Records a timeline of what the engine and the game were doing, for
+/// viewing in Chrome's `about:tracing` or at https://ui.perfetto.dev.
+///
+/// While the tracer is recording, the engine records each phase of each
+/// frame (see Frame_phase), and every @ref GE211_TRACE_SCOPE records the
+/// time from where it appears to the end of its enclosing block. Events
+/// go into a buffer for each thread, so recording takes no locks; each
+/// buffer keeps only the most recent events. write() saves everything
+/// still buffered to a file in the Chrome trace event format.
+///
+/// When the tracer isn't recording, a @ref GE211_TRACE_SCOPE costs one
+/// check of a flag. Defining `GE211_NO_TRACE` before including ge211
+/// removes them entirely.
+///
+/// The engine starts recording before Abstract_game::on_start() if the
+/// environment variable `GE211_TRACE` is set to a filename, and writes
+/// the trace to that file after Abstract_game::on_quit().
+///
+/// There's only one Tracer (Singleton Pattern).
+class Tracer
+{
+public:
+    /// How many of the most recent events each thread keeps.
+    static const size_t events_per_thread = 1 << 15;
+
+    /// Returns the one and only tracer instance.
+    static Tracer& instance() NOEXCEPT;
+
+    /// Starts recording, or keeps on recording if it already is. The
+    /// trace will be written to the given file by write().
+    void start(std::string filename);
+
+    /// Stops recording. What has been recorded so far is kept for write().
+    void stop() NOEXCEPT;
+
+    /// Is the tracer recording?
+    bool is_recording() const NOEXCEPT
+    { return recording_.load(std::memory_order_relaxed); }
+
+    /// Writes every buffered event to the file given to start(), in the
+    /// Chrome trace event JSON format. It can be called while recording,
+    /// for example from a key handler, in which case the events keep
+    /// going into the buffers. Written that way, the trace is best-effort:
+    /// events that other threads overwrite while it's being copied are
+    /// left out. Returns whether it succeeded, and logs a warning if not.
+    bool write() const;
+
+    /// Records that something called `name` in `category` ran from
+    /// `start` to `end` on the calling thread. Both strings must live
+    /// forever (string literals are best). Does nothing unless recording.
+    void record(char const* category,
+                char const* name,
+                Time_point start,
+                Time_point end) NOEXCEPT;
+
+private:
+    Tracer() NOEXCEPT;
+
+    std::atomic<bool> recording_;
+    std::string filename_;
+    Time_point epoch_;
+};
+
+/// Records the time from its construction to its destruction with the
+/// Tracer, if it is recording. Use it through @ref GE211_TRACE_SCOPE.
+class Trace_scope
+{
+public:
+    /// Starts timing, if the Tracer is recording. Both strings must live
+    /// forever.
+    Trace_scope(char const* category, char const* name) NOEXCEPT
+            : category_{category},
+              name_{Tracer::instance().is_recording()? name : nullptr}
+    {
+        if (name_) start_ = Time_point::now();
+    }
+
+    /// Records the event, if it was started.
+    ~Trace_scope()
+    {
+        if (name_) {
+            Tracer::instance().record(category_, name_,
+                                      start_, Time_point::now());
+        }
+    }
+
+    Trace_scope(Trace_scope const&) = delete;
+    Trace_scope& operator=(Trace_scope const&) = delete;
+
+private:
+    char const* category_;
+    char const* name_;
+    Time_point start_;
+};
+
+} // end namespace profile
+
+namespace detail {
+
+// The renderer reports each texture it creates and destroys, for
+// profile::texture_usage.
+void note_texture_created(long bytes) NOEXCEPT;
+void note_texture_destroyed(long bytes) NOEXCEPT;
+
+} // end namespace detail
+
+}
+
+#define GE211_TRACE_CONCAT_2_(A, B) A##B
+#define GE211_TRACE_CONCAT_(A, B) GE211_TRACE_CONCAT_2_(A, B)
+
+/// Records the rest of the enclosing block with the profile::Tracer, as
+/// an event with the given category and name, which must be string
+/// literals.
+///
+/// \example
+///
+/// ```
+/// void View::draw(ge211::Sprite_set& set)
+/// {
+///     GE211_TRACE_SCOPE("view", "draw");
+///     ...
+/// }
+/// ```
+#ifdef GE211_NO_TRACE
+#  define GE211_TRACE_SCOPE(CATEGORY, NAME) ((void) 0)
+#else
+#  define GE211_TRACE_SCOPE(CATEGORY, NAME)                              \
+    ::ge211::profile::Trace_scope                                        \
+    GE211_TRACE_CONCAT_(ge211_trace_scope_, __LINE__){"" CATEGORY, "" NAME}
+#endif
@@ -9,8 +9,19 @@
 
 #include <SDL_render.h>
 #include <SDL_surface.h>
+#include <SDL_version.h>
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
+
+// SDL_RenderGeometry, which the renderer uses to draw many quads with one
+// call, is new in SDL 2.0.18. Before that, each quad is its own call.
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#   define GE211_BATCH_GEOMETRY 1
+#else
+#   define GE211_BATCH_GEOMETRY 0
+#endif
 
 namespace ge211 {
 
@@ -18,8 +29,27 @@ namespace detail {
 
 using Uniq_SDL_Renderer = delete_ptr<SDL_Renderer, &SDL_DestroyRenderer>;
 using Uniq_SDL_Surface  = delete_ptr<SDL_Surface, &SDL_FreeSurface>;
-using Uniq_SDL_Texture  = delete_ptr<SDL_Texture, &SDL_DestroyTexture>;
 
+// Textures are created with create_texture_from_surface or create_texture
+// and destroyed with destroy_texture, which keep count of them for
+// profile::texture_usage.
+Owned<SDL_Texture> create_texture_from_surface(Borrowed<SDL_Renderer>,
+                                               Borrowed<SDL_Surface>);
+Owned<SDL_Texture> create_texture(Borrowed<SDL_Renderer>,
+                                  uint32_t format, int access,
+                                  int width, int height);
+void destroy_texture(Owned<SDL_Texture>);
+
+using Uniq_SDL_Texture  = delete_ptr<SDL_Texture, &destroy_texture>;
+
+// Where GE211_BATCH_GEOMETRY is on, fill_rectangle, copy and copy_glyphs
+// don't draw right away. Quads are collected for as long as they share a
+// texture (or, for solid rectangles, have none), then sent to SDL as one
+// SDL_RenderGeometry call, so a frame of many similar sprites costs a
+// few calls rather than one per sprite. Anything that can't be batched
+// (rotation, for instance) sends the pending batch first, so drawing
+// order is always preserved. flush() sends whatever is pending; clear()
+// and present() call it.
 class Renderer
 {
 public:
@@ -30,9 +60,24 @@ public:
     void set_color(Color);
 
     void clear();
+    // Fills the rectangle with the color, blending if it is translucent.
+    void fill_rectangle(const Rect<int>&, Color);
     void copy(const Texture&, Posn<int>);
     void copy(const Texture&, Posn<int>, const Transform&);
 
+    // Draws a row of glyph cells from the atlas (see
+    // Glyph_atlas::glyph), left to right from the given position, in the
+    // given color and scale.
+    void copy_glyphs(Glyph_atlas&,
+                     const std::vector<Rect<int>>& cells,
+                     Posn<int>,
+                     Color,
+                     double scale_x = 1,
+                     double scale_y = 1);
+
+    // Sends any batched quads to SDL.
+    void flush();
+
     // Prepares a texture for rendering with this given renderer, without
     // actually copying it.
     void prepare(const Texture&) const;
@@ -41,12 +86,30 @@ public:
 
 private:
     friend Texture;
+    friend Glyph_atlas;
 
     Borrowed<SDL_Renderer> get_raw_() const NOEXCEPT;
 
     static Owned<SDL_Renderer> create_renderer_(Borrowed<SDL_Window>);
 
     Uniq_SDL_Renderer ptr_;
+
+#if GE211_BATCH_GEOMETRY
+    // Adds one quad to the batch, sending the batch first if it is for a
+    // different texture. The texture may be null for a solid color.
+    // (x0, y0)-(x1, y1) is where it goes on screen, and (u0, v0)-(u1, v1)
+    // the part of the texture, as fractions of its size.
+    void batch_quad_(Borrowed<SDL_Texture>,
+                     float x0, float y0, float x1, float y1,
+                     float u0, float v0, float u1, float v1,
+                     Color);
+
+    // The pending batch. These keep their capacity, so batching doesn't
+    // allocate once they have grown to fit a frame.
+    Borrowed<SDL_Texture> batch_texture_ = nullptr;
+    std::vector<SDL_Vertex> batch_vertices_;
+    std::vector<int> batch_indices_;
+#endif
 };
 
 // A texture is initially created as a (device-independent) `SDL_Surface`,
@@ -65,14 +128,51 @@ public:
     explicit Texture(Owned<SDL_Surface> surface);
     explicit Texture(Uniq_SDL_Surface);
 
+    // A texture for just the given region of another, which it shares:
+    // both are uploaded as one `SDL_Texture`, so copies of regions of the
+    // same sheet can be batched together. See pack().
+    Texture(const Texture& sheet, const Rect<int>& region) NOEXCEPT;
+
+    // The dimensions of the region, for a texture made from a region.
     Dims<int> dimensions() const NOEXCEPT;
 
     // Returns nullptr if this `Texture` has been rendered, and can no
-    // longer be updated as an `SDL_Surface`.
+    // longer be updated as an `SDL_Surface`. Also returns nullptr for a
+    // region of a sheet, since painting on it would paint on the sheet.
     Borrowed<SDL_Surface> raw_surface() NOEXCEPT;
 
     bool empty() const NOEXCEPT;
 
+    // Copies each of the given textures that is still a surface, and has
+    // no side longer than max_side, into a sheet of at most sheet_dims,
+    // then replaces it with a Texture for its region of that sheet.
+    // Textures sharing one surface are copied once. Returns how many
+    // sheets it made.
+    //
+    // Copies from the same sheet one after another are batched into one
+    // call by the renderer, rather than switching textures each time.
+    static size_t pack(const std::vector<Texture*>&,
+                       Dims<int> sheet_dims,
+                       int max_side);
+
+    // Refers to a texture without keeping it alive, for caches.
+    class Weak
+    {
+    public:
+        Weak() NOEXCEPT;
+        explicit Weak(const Texture&) NOEXCEPT;
+
+        // Returns the texture, or an empty texture if every `Texture`
+        // sharing it has been destroyed.
+        Texture lock() const NOEXCEPT;
+
+        bool expired() const NOEXCEPT;
+
+    private:
+        std::weak_ptr<void> impl_;
+        Rect<int> region_;
+    };
+
 private:
     friend Renderer;
 
@@ -94,7 +194,59 @@ private:
 
     Borrowed<SDL_Texture> get_raw_(const Renderer&) const;
 
+    // The dimensions of the whole underlying surface or texture.
+    Dims<int> sheet_dimensions_() const NOEXCEPT;
+    // The part of the underlying surface or texture this copies.
+    Rect<int> source_rect_() const NOEXCEPT;
+
     std::shared_ptr<Impl_> impl_;
+    // Zero-sized unless this is a region of a sheet.
+    Rect<int> region_;
+};
+
+// The glyphs of one font, each rasterized once, in white, into a shared
+// texture that grows as new glyphs are needed. Strings are then drawn
+// with Renderer::copy_glyphs as one quad per glyph, in any color.
+class Glyph_atlas
+{
+public:
+    // Borrows the font, which must outlive the atlas.
+    explicit Glyph_atlas(Borrowed<TTF_Font>);
+
+    // Where the glyph for the given code point is in the atlas, adding it
+    // the first time it's asked for. Each cell is as wide as the glyph's
+    // advance and line_height() tall; a glyph the font can't render gets
+    // a cell with no width.
+    Rect<int> glyph(uint32_t code_point);
+
+    int line_height() const NOEXCEPT;
+
+private:
+    friend Renderer;
+
+    Rect<int> add_glyph_(uint32_t code_point);
+    // Makes the atlas surface taller (and at least min_width wide).
+    void grow_(int min_width);
+    // Uploads the surface if it has changed since the last upload.
+    Borrowed<SDL_Texture> get_raw_(Renderer&);
+
+    Borrowed<TTF_Font> font_;
+    int line_height_;
+
+    // The atlas itself. texture_ is a copy of surface_, brought up to
+    // date when the atlas is next drawn after a glyph is added.
+    Uniq_SDL_Surface surface_;
+    Uniq_SDL_Texture texture_;
+    Dims<int> texture_dims_;
+    bool dirty_;
+
+    // Where the next glyph goes.
+    Posn<int> cursor_;
+
+    // Cells for ASCII are kept in an array; a zero height means not
+    // added yet.
+    Rect<int> ascii_[128];
+    std::unordered_map<uint32_t, Rect<int>> others_;
 };
 
 } // end namespace detail
@@ -14,6 +14,7 @@ extern DECLSPEC void SDLCALL TTF_CloseFont(TTF_Font*);
 }
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,11 @@ open_binary_resource_file(std::string const& filename);
 
 namespace detail {
 
+// An open resource file, read through an SDL_RWops. If there's a resource
+// bundle (see ge211_bundle.hxx) with the file in it, it's read from there.
+// Otherwise the file's contents are mapped into memory the first time it's
+// opened, and every later File_resource for the same file reads the same
+// bytes.
 class File_resource
 {
 public:
@@ -66,19 +72,66 @@ private:
 /// Font%s. The usual place to define Font%s is as member variables in
 /// your game struct, since member variables of a derived class are
 /// initialized after the base class is initialized.
+///
+/// Several threads may render Text_sprite%s with the same Font at once
+/// (see parallel_for()); each gets a copy of the font of its own.
 class Font
 {
 public:
     /// Loads a font from the specified TrueType font file, at the specified
-    /// size.
+    /// size. Fonts loaded from the same file share one copy of it in
+    /// memory, so loading a font at several sizes is cheap.
     Font(const std::string& filename, int size);
 
+    Font(Font&&) NOEXCEPT;
+    Font& operator=(Font&&) NOEXCEPT;
+    ~Font();
+
 private:
     friend Text_sprite;
+    friend Glyph_text_sprite;
+    friend detail::Font_lease;
 
-    Borrowed<TTF_Font> get_raw_() const NOEXCEPT { return ptr_.get(); }
+    // Different for every Font ever loaded, unlike the address, so that
+    // text rendered with a font can be cached by it.
+    unsigned long get_id_() const NOEXCEPT { return id_; }
 
-    detail::delete_ptr<TTF_Font, &TTF_CloseFont, true> ptr_;
+    // The glyph atlas for this font, made the first time it's needed and
+    // shared by every Glyph_text_sprite that uses the font. The atlas
+    // keeps a copy of the font to itself.
+    std::shared_ptr<detail::Glyph_atlas> get_atlas_() const;
+
+    std::unique_ptr<detail::Font_handles> handles_;
+    unsigned long id_;
+    mutable std::shared_ptr<detail::Glyph_atlas> atlas_;
 };
 
+namespace detail {
+
+// Borrows a copy of a Font's TTF_Font for as long as it lives. FreeType
+// fonts can't be used by two threads at once, so the Font keeps copies
+// that aren't in use, and a lease that finds none opens another from the
+// same file (which is cheap, since the file is cached).
+//
+// Opening and closing copies share one FreeType library, so they all take
+// one process-wide lock. Only rendering with a leased copy runs unlocked.
+class Font_lease
+{
+public:
+    // Throws Font_error if another copy is needed but can't be opened.
+    explicit Font_lease(const Font&);
+    ~Font_lease();
+
+    Borrowed<TTF_Font> get_raw() const NOEXCEPT { return raw_; }
+
+    Font_lease(const Font_lease&) = delete;
+    Font_lease& operator=(const Font_lease&) = delete;
+
+private:
+    Font_handles& handles_;
+    Owned<TTF_Font> raw_;
+};
+
+} // end namespace detail
+
 }
@@ -8,11 +8,31 @@
 #include "ge211_render.hxx"
 #include "ge211_resource.hxx"
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include <sstream>
 
 namespace ge211 {
 
+namespace detail {
+
+// Everything a Text_sprite's texture depends on.
+struct Text_key
+{
+    unsigned long font_id;
+    std::string   message;
+    uint32_t      color;
+    bool          antialias;
+    int           word_wrap;
+
+    bool operator==(Text_key const&) const;
+    bool operator<(Text_key const&) const;
+};
+
+} // end namespace detail
+
 /// Sprites are images that can be rendered to the screen. This namespace
 /// defines a base Sprite class that declares common sprite operations,
 /// and four specific types of sprites with different purposes.
@@ -79,6 +99,8 @@ public:
     Dims<int> dimensions() const override;
 
 private:
+    friend Sprite_atlas;
+
     void render(detail::Renderer&, Posn<int>, Transform const&) const override;
     void prepare(detail::Renderer const&) const override;
 
@@ -189,6 +211,41 @@ public:
     void recolor(Color);
 };
 
+/// A Sprite that renders as a solid rectangle without a texture.
+///
+/// A Rectangle_sprite is an image like any other: it allocates a surface
+/// of its size, which is then uploaded as a texture, just to show one
+/// color. A Solid_rectangle_sprite is drawn directly by the renderer
+/// (`SDL_RenderFillRect`), so it uses no texture memory however large it
+/// is, and changing its color is free. Translucent colors are blended
+/// over what is below, and it is layered by *z* like any other sprite.
+///
+/// Scaling transforms apply; rotation is ignored.
+class Solid_rectangle_sprite : public Sprite
+{
+public:
+    /// Constructs a solid rectangle sprite from required Dims
+    /// and an optional Color, which defaults to white.
+    ///
+    /// \preconditions
+    ///  - both dimensions must be positive
+    explicit Solid_rectangle_sprite(Dims<int>, Color = Color::white());
+
+    /// Changes the color of this rectangle sprite.
+    void recolor(Color);
+
+    /// The color of this rectangle sprite.
+    Color color() const;
+
+    Dims<int> dimensions() const override;
+
+private:
+    void render(detail::Renderer&, Posn<int>, Transform const&) const override;
+
+    Dims<int> dimensions_;
+    Color color_;
+};
+
 /// A Sprite that renders as a solid circle.
 class Circle_sprite : public internal::Render_sprite
 {
@@ -308,6 +365,12 @@ public:
     class Builder;
 
     /// Resets this text sprite with the configuration from the given Builder.
+    ///
+    /// Text is only rendered when it hasn't been seen before: if the
+    /// font, message, color, anti-aliasing and wrap width are the same as
+    /// this sprite's current configuration, or as any other Text_sprite
+    /// that still exists, the existing texture is shared. So it is cheap
+    /// to call this every frame with the same message.
     void reconfigure(Builder const&);
 
 private:
@@ -317,9 +380,14 @@ private:
 
     detail::Texture const& get_texture_() const override;
 
-    static detail::Texture create_texture(Builder const&);
+    static detail::Text_key make_key_(Builder const&);
+
+    // Finds a live texture for the key or renders a new one.
+    static detail::Texture create_texture(detail::Text_key const&,
+                                          Builder const&);
 
     detail::Texture texture_;
+    detail::Text_key key_;
 };
 
 /// Builder-style API for configuring and constructing Text_sprite%s.
@@ -450,6 +518,73 @@ private:
     uint32_t word_wrap_;
 };
 
+/// A Sprite that displays one line of text, drawn glyph by glyph from an
+/// atlas.
+///
+/// A Text_sprite renders its whole message into a texture of its own, so
+/// every new message means new text rendering and a new texture upload.
+/// A Glyph_text_sprite instead uses a glyph atlas belonging to its Font:
+/// each glyph is rendered the first time any Glyph_text_sprite with that
+/// Font needs it, and after that the message is drawn as one textured
+/// quad per glyph, in a single batch. This makes it the better choice for
+/// text that changes often, such as scores and counters: once its glyphs
+/// have been seen, reconfiguring and drawing it allocate nothing.
+///
+/// Glyphs are placed side by side without kerning, and the text doesn't
+/// wrap. Scaling transforms apply; rotation and flips are ignored. The
+/// Font must outlive the sprite.
+///
+/// \example
+///
+/// ```
+/// struct View
+/// {
+///     ge211::Font sans20{"sans.ttf", 20};
+///     ge211::Glyph_text_sprite score_sprite{sans20};
+///
+///     void draw(ge211::Sprite_set& set, int score)
+///     {
+///         score_sprite.reconfigure(std::to_string(score));
+///         set.add_sprite(score_sprite, {10, 10});
+///     }
+/// };
+/// ```
+class Glyph_text_sprite : public Sprite
+{
+public:
+    /// Constructs a glyph text sprite with the given font and color,
+    /// initially showing nothing.
+    explicit Glyph_text_sprite(Font const&, Color = Color::white());
+
+    /// Constructs a glyph text sprite showing the given UTF-8 message.
+    Glyph_text_sprite(std::string const&, Font const&,
+                      Color = Color::white());
+
+    /// Changes the message. Does nothing if it is the same as before.
+    ///
+    /// Throws @ref exceptions::Client_logic_error if the message isn't
+    /// valid UTF-8.
+    void reconfigure(std::string const&);
+
+    /// Changes the color of the text.
+    void recolor(Color);
+
+    /// The current message.
+    std::string const& message() const;
+
+    Dims<int> dimensions() const override;
+
+private:
+    void render(detail::Renderer&, Posn<int>, Transform const&) const override;
+
+    std::shared_ptr<detail::Glyph_atlas> atlas_;
+    std::string message_;
+    Color color_;
+    // The atlas cell of each glyph of the message, and their total width.
+    std::vector<Rect<int>> cells_;
+    int width_;
+};
+
 /// A Sprite that allows switching between other sprites based on the
 /// time at rendering.
 class Multiplexed_sprite : public Sprite
@@ -470,6 +605,69 @@ private:
     Timer since_;
 };
 
+/// Packs the textures of many small sprites into a few shared ones.
+///
+/// Each Image_sprite, Text_sprite, Rectangle_sprite and Circle_sprite
+/// normally has a texture of its own, so drawing a scene of them means
+/// switching textures between nearly every sprite. Sprites added to a
+/// Sprite_atlas are copied, when pack() is called, onto shared sheets,
+/// and from then on are drawn from their part of a sheet. Sprites from
+/// the same sheet drawn one after another go to the renderer as a single
+/// batch.
+///
+/// Packing is meant for startup: after the sprites are made, before they
+/// are first drawn. Sprites that have already been drawn (or prepared)
+/// are left alone, as are sprites with a side longer than the maximum
+/// given to the constructor. A packed Render_sprite can no longer be
+/// painted on, just as if it had been drawn. A sprite that gets a new
+/// texture later, such as a reconfigured Text_sprite, simply stops using
+/// the atlas.
+///
+/// \example
+///
+/// ```
+/// View::View()
+/// {
+///     ge211::Sprite_atlas atlas;
+///     for (ge211::Text_sprite& label : labels) {
+///         atlas.add(label);
+///     }
+///     atlas.add(title).add(player);
+///     atlas.pack();
+/// }
+/// ```
+class Sprite_atlas
+{
+public:
+    /// Constructs an atlas whose sheets are at most the given dimensions,
+    /// and which takes sprites with no side longer than `max_side`.
+    ///
+    /// \preconditions
+    ///  - both dimensions and `max_side` must be positive
+    ///  - `max_side` must fit in the sheet dimensions
+    explicit Sprite_atlas(Dims<int> sheet_dims = {1024, 1024},
+                          int max_side = 256);
+
+    /// Adds a sprite to be packed by the next call to pack(). Sprites that
+    /// aren't drawn from a texture, such as Solid_rectangle_sprite and
+    /// Glyph_text_sprite, and empty Text_sprite%s are ignored.
+    ///
+    /// \ownership
+    ///
+    /// The atlas keeps a reference to the sprite until pack() is called,
+    /// so the sprite must not be moved or destroyed before then.
+    Sprite_atlas& add(Sprite&);
+
+    /// Packs the sprites added since the last call, returning the number
+    /// of sheets made.
+    size_t pack();
+
+private:
+    Dims<int> sheet_dims_;
+    int max_side_;
+    std::vector<detail::Texture*> textures_;
+};
+
 } // end namespace sprites
 
 namespace detail {
@@ -486,8 +684,6 @@ struct Placed_sprite
     void render(Renderer&) const;
 };
 
-bool operator<(Placed_sprite const&, Placed_sprite const&) NOEXCEPT;
-
 } // end namespace detail
 
 /// A collection of positioned [Sprite](@ref ge211::sprites::Sprite)s
@@ -516,9 +712,8 @@ public:
     /// corner of the window.
     /// \param z (*optional*, defaults to 0) The *z* coordinate, which
     /// determines the relative layering of all the sprites in the window.
-    /// The layering of sprites placed with the same *z* is unspecified and
-    /// not related to the order in which they were added, so you may need to
-    /// specify *z* if sprites overlap and you care which appears in front.
+    /// Sprites placed with the same *z* are layered in the order they were
+    /// added, so a sprite added later appears in front.
     /// \param transform (*optional*, defaults to the identity transform)
     /// A [Transform] allows scaling, flipping, and rotating the [Sprite]
     /// when it is rendered.
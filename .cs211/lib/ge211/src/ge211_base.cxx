@@ -12,6 +12,7 @@ using namespace detail;
 const Dims<int> Abstract_game::default_window_dimensions{800, 600};
 const char* const Abstract_game::default_window_title = "ge211 window";
 const Color Abstract_game::default_background_color = Color::black();
+const double Abstract_game::default_frame_rate = 60;
 
 // How many frames to run before calculating the frame rate.
 static int const frames_per_sample = 30;
@@ -55,6 +56,36 @@ void Abstract_game::prepare(const sprites::Sprite& sprite) const
     }
 }
 
+void Abstract_game::warm_up(const sprites::Sprite& sprite)
+{
+    warm_up_queue_.push_back(&sprite);
+}
+
+size_t Abstract_game::warm_up_remaining() const NOEXCEPT
+{
+    return warm_up_queue_.size() - warm_up_next_;
+}
+
+void Abstract_game::warm_up_step_()
+{
+    if (warm_up_remaining() == 0) return;
+
+    GE211_TRACE_SCOPE("ge211", "warm_up");
+
+    Timer timer;
+
+    do {
+        prepare(*warm_up_queue_[warm_up_next_++]);
+    } while (warm_up_remaining() > 0 &&
+             (warm_up_budget <= Duration(0) ||
+              timer.elapsed_time() < warm_up_budget));
+
+    if (warm_up_remaining() == 0) {
+        warm_up_queue_.clear();
+        warm_up_next_ = 0;
+    }
+}
+
 void Abstract_game::mark_present_() NOEXCEPT
 {
     busy_time_.pause();
@@ -74,6 +105,12 @@ void Abstract_game::mark_frame_() NOEXCEPT
     }
 }
 
+void Abstract_game::mark_idle_frame_(Duration nominal) NOEXCEPT
+{
+    mark_frame_();
+    prev_frame_length_ = nominal;
+}
+
 void Abstract_game::poll_channels_()
 {
     if (mixer_.is_forced())
@@ -1,5 +1,6 @@
 #include "ge211_engine.hxx"
 #include "ge211_base.hxx"
+#include "ge211_profile.hxx"
 #include "ge211_render.hxx"
 #include "ge211_sprites.hxx"
 
@@ -7,6 +8,9 @@
 #include "utf8.h"
 
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 
 namespace ge211 {
@@ -44,41 +48,96 @@ void Engine::run()
     Sprite_set sprites;
 
     bool has_vsync = renderer_.is_vsync();
+    auto& timing = game_.frame_timing_;
+
+    // Tracing can be turned on for any game, with no changes to it.
+    auto& tracer = Tracer::instance();
+    if (char const* trace_file = std::getenv("GE211_TRACE"))
+        tracer.start(trace_file);
 
     try {
         game_.on_start();
+        timing.start_frame_();
 
         while (!game_.quit_) {
             handle_events_(e);
+            timing.end_phase_(Frame_phase::events);
             game_.on_frame(game_.get_prev_frame_length().seconds());
+            timing.end_phase_(Frame_phase::on_frame);
             game_.poll_channels_();
-            game_.draw(sprites);
-
-            renderer_.set_color(game_.background_color);
-            renderer_.clear();
-            paint_sprites_(sprites);
+            timing.end_phase_(Frame_phase::poll_channels);
+
+            // There's no point drawing what can't be seen.
+            if (!is_hidden_) {
+                game_.warm_up_step_();
+                game_.draw(sprites);
+                timing.end_phase_(Frame_phase::draw);
+
+                renderer_.set_color(game_.background_color);
+                renderer_.clear();
+                paint_sprites_(sprites);
+                timing.end_phase_(Frame_phase::paint);
+            } else {
+                timing.end_phase_(Frame_phase::draw);
+                timing.end_phase_(Frame_phase::paint);
+            }
 
             game_.mark_present_();
-            renderer_.present();
+            if (!is_hidden_) renderer_.present();
+            timing.end_phase_(Frame_phase::present);
 
             Duration allowed_frame_length =
                     (is_focused_ && has_vsync)?
                     min_frame_length : software_frame_length;
 
+            // In the background, frames are further apart, or don't
+            // happen at all until an event arrives.
+            bool in_background = is_hidden_ || !is_focused_;
+            double background_rate = is_hidden_?
+                                     game_.hidden_frame_rate :
+                                     game_.unfocused_frame_rate;
+            if (in_background && background_rate > 0) {
+                allowed_frame_length = std::max(allowed_frame_length,
+                                                Duration(1 / background_rate));
+            }
+
             auto frame_length = game_.frame_start_.elapsed_time();
-            if (frame_length < allowed_frame_length) {
+            if (in_background && background_rate <= 0) {
+                SDL_WaitEvent(nullptr);
+                game_.mark_frame_();
+            } else if (game_.is_idle() && game_.warm_up_remaining() == 0) {
+                // Until an event arrives, the next frame would draw the
+                // same thing as this one, so rather than run it, wait.
+                // The event stays in the queue for handle_events_.
+                long timeout = std::min(game_.idle_timeout().milliseconds(),
+                                        long(INT_MAX));
+                SDL_WaitEventTimeout(nullptr, int(std::max(timeout, 0L)));
+                game_.mark_idle_frame_(software_frame_length);
+            } else if (in_background && frame_length < allowed_frame_length) {
+                // Wait out a background frame, but wake up early for an
+                // event, such as getting the focus back.
+                auto duration = allowed_frame_length - frame_length;
+                SDL_WaitEventTimeout(nullptr, int(duration.milliseconds()));
+                game_.mark_frame_();
+            } else if (frame_length < allowed_frame_length) {
                 auto duration = allowed_frame_length - frame_length;
                 duration.sleep_for();
                 game_.mark_frame_();
-                internal::logging::debug()
+                GE211_LOG(debug)
                     << "Software vsync slept for "
                     << duration.seconds() << " s";
             } else {
                 game_.mark_frame_();
             }
+            timing.end_frame_();
         }
 
         game_.on_quit();
+
+        if (tracer.is_recording()) {
+            tracer.stop();
+            tracer.write();
+        }
     } catch (const Exception_base& e) {
         internal::logging::fatal()
             << "Uncaught exception:\n  "
@@ -150,6 +209,18 @@ void Engine::handle_events_(SDL_Event& e)
                         is_focused_ = false;
                         break;
 
+                    case SDL_WINDOWEVENT_HIDDEN:
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                        is_hidden_ = true;
+                        break;
+
+                    case SDL_WINDOWEVENT_SHOWN:
+                    case SDL_WINDOWEVENT_EXPOSED:
+                    case SDL_WINDOWEVENT_MAXIMIZED:
+                    case SDL_WINDOWEVENT_RESTORED:
+                        is_hidden_ = false;
+                        break;
+
                     default:
                         ;
                 }
@@ -163,18 +234,61 @@ void Engine::handle_events_(SDL_Event& e)
 
 void Engine::paint_sprites_(Sprite_set& sprite_set)
 {
-    auto& vec   = sprite_set.sprites_;
-    auto  begin = vec.begin(),
-          end   = vec.end();
+    sort_sprites_(sprite_set);
+
+    for (const Placed_sprite* placed : paint_order_) {
+        placed->render(renderer_);
+    }
 
-    std::make_heap(begin, end);
+    // Consecutive sprites with the same texture have been batched up by
+    // the renderer; send the last batch.
+    renderer_.flush();
 
-    while (begin != end) {
-        std::pop_heap(begin, end--);
-        end->render(renderer_);
+    paint_order_.clear();
+    sprite_set.sprites_.clear();
+}
+
+void Engine::sort_sprites_(const Sprite_set& sprite_set)
+{
+    auto const& vec = sprite_set.sprites_;
+    paint_order_.clear();
+    if (vec.empty()) return;
+
+    int min_z = vec[0].z;
+    int max_z = vec[0].z;
+    for (const Placed_sprite& placed : vec) {
+        min_z = std::min(min_z, placed.z);
+        max_z = std::max(max_z, placed.z);
     }
 
-    vec.clear();
+    // Games use a handful of z values, so usually one counting pass and
+    // one placing pass do it. If the z values are spread out too far for
+    // a table of counts, fall back to a comparison sort.
+    size_t range = size_t(int64_t(max_z) - int64_t(min_z)) + 1;
+    if (range > std::max(size_t(1024), 2 * vec.size())) {
+        for (const Placed_sprite& placed : vec) {
+            paint_order_.push_back(&placed);
+        }
+        std::stable_sort(paint_order_.begin(), paint_order_.end(),
+                         [](const Placed_sprite* a, const Placed_sprite* b) {
+                             return a->z < b->z;
+                         });
+        return;
+    }
+
+    // z_counts_[i] becomes where the first sprite with z = min_z + i goes.
+    z_counts_.assign(range + 1, 0);
+    for (const Placed_sprite& placed : vec) {
+        ++z_counts_[size_t(placed.z - min_z) + 1];
+    }
+    for (size_t i = 1; i < range; ++i) {
+        z_counts_[i] += z_counts_[i - 1];
+    }
+
+    paint_order_.resize(vec.size());
+    for (const Placed_sprite& placed : vec) {
+        paint_order_[z_counts_[size_t(placed.z - min_z)]++] = &placed;
+    }
 }
 
 Window& Engine::get_window() NOEXCEPT
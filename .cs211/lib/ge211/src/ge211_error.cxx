@@ -4,7 +4,12 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace ge211 {
 
@@ -163,6 +168,109 @@ log_level_string(Log_level level)
     return "<unknown>";
 }
 
+namespace {
+
+// Prints finished log messages on a thread of its own.
+class Log_sink
+{
+public:
+    // Returns the sink, starting it if need be, or null if it has already
+    // been shut down at exit.
+    static Log_sink* instance();
+
+    // Queues the text to be printed.
+    void write(std::string text);
+
+    // Waits until the queue is empty and the printer is idle.
+    void flush();
+
+    // Prints whatever is left, then stops the thread.
+    ~Log_sink();
+
+private:
+    Log_sink();
+
+    void run_();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::string> queue_;
+    bool printing_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Once the sink is destroyed (at exit), messages are printed directly.
+// Written by the sink's destructor, and read by any thread that logs.
+std::atomic<bool> log_sink_shut_down{false};
+
+Log_sink* Log_sink::instance()
+{
+    if (log_sink_shut_down) return nullptr;
+
+    static Log_sink instance;
+    return &instance;
+}
+
+Log_sink::Log_sink()
+        : thread_{&Log_sink::run_, this}
+{ }
+
+Log_sink::~Log_sink()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+    log_sink_shut_down = true;
+}
+
+void Log_sink::write(std::string text)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(text));
+    }
+    changed_.notify_all();
+}
+
+void Log_sink::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return queue_.empty() && !printing_; });
+}
+
+void Log_sink::run_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+
+        std::deque<std::string> batch;
+        batch.swap(queue_);
+        printing_ = true;
+        lock.unlock();
+
+        for (std::string const& text : batch) std::cerr << text;
+        std::cerr.flush();
+
+        lock.lock();
+        printing_ = false;
+        changed_.notify_all();
+    }
+}
+
+} // end anonymous namespace
+
+void flush()
+{
+    if (Log_sink* sink = Log_sink::instance()) sink->flush();
+}
+
 Log_message debug(std::string reason)
 {
     return Log_message{std::move(reason), Log_level::debug};
@@ -192,10 +300,17 @@ Logger& Logger::instance() NOEXCEPT
 Log_message::Log_message(std::string reason, Log_level level) NOEXCEPT
         : reason_{std::move(reason)}
         , message_{}
-        , active_{level >= Logger::instance().level()}
+        , level_{level}
 {
-    if (active_)
-        message_ << "ge211[" << log_level_string(level) << "]: ";
+    if (Logger::instance().enabled(level)) {
+        // If there's no memory for the message, it just isn't logged.
+        try {
+            message_.reset(new std::ostringstream);
+            *message_ << "ge211[" << log_level_string(level) << "]: ";
+        } catch (...) {
+            message_.reset();
+        }
+    }
 }
 
 Log_message::Log_message(Log_level level)
@@ -204,10 +319,19 @@ Log_message::Log_message(Log_level level)
 
 Log_message::~Log_message()
 {
-    if (active_) {
-        std::cerr << message_.str();
-        if (!reason_.empty()) std::cerr << "\n  (Reason: " << reason_ << ")";
-        std::cerr << std::endl;
+    if (!message_) return;
+
+    if (!reason_.empty()) *message_ << "\n  (Reason: " << reason_ << ")";
+    *message_ << '\n';
+
+    Log_sink* sink = Log_sink::instance();
+    if (sink && level_ != Log_level::fatal) {
+        sink->write(message_->str());
+    } else {
+        // A fatal message is usually followed by exiting, so don't leave
+        // it in the queue.
+        if (sink) sink->flush();
+        std::cerr << message_->str() << std::flush;
     }
 }
 
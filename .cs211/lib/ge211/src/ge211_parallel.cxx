@@ -0,0 +1,156 @@
+#include "ge211_parallel.hxx"
+#include "ge211_profile.hxx"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ge211 {
+
+namespace {
+
+// Set on threads that are running a job, so that a nested parallel_for
+// doesn't wait on the pool it's part of.
+thread_local bool in_job = false;
+
+// Worker threads that take turns at the jobs of one parallel_for at a
+// time.
+class Worker_pool
+{
+public:
+    static Worker_pool& instance()
+    {
+        static Worker_pool instance;
+        return instance;
+    }
+
+    size_t size() const NOEXCEPT { return threads_.size(); }
+
+    void run(size_t count, std::function<void(size_t)> const& job);
+
+    ~Worker_pool();
+
+private:
+    Worker_pool();
+
+    void work_();
+
+    // Runs jobs from the current batch until there are none left to start.
+    // Called, and returns, with the lock held.
+    void take_jobs_(std::unique_lock<std::mutex>&);
+
+    // Only one parallel_for at a time uses the pool.
+    std::mutex run_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+
+    std::function<void(size_t)> const* job_ = nullptr;
+    size_t count_ = 0;
+    size_t next_ = 0;
+    size_t finished_ = 0;
+    std::exception_ptr error_;
+    bool stopping_ = false;
+
+    std::vector<std::thread> threads_;
+};
+
+Worker_pool::Worker_pool()
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    size_t workers = cores > 1 ? cores - 1 : 0;
+
+    for (size_t i = 0; i < workers; ++i)
+        threads_.emplace_back(&Worker_pool::work_, this);
+}
+
+Worker_pool::~Worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+
+    for (auto& thread : threads_) thread.join();
+}
+
+void Worker_pool::run(size_t count, std::function<void(size_t)> const& job)
+{
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    job_ = &job;
+    count_ = count;
+    next_ = 0;
+    finished_ = 0;
+    error_ = nullptr;
+    work_ready_.notify_all();
+
+    take_jobs_(lock);
+    work_done_.wait(lock, [this] { return finished_ == count_; });
+
+    job_ = nullptr;
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    lock.unlock();
+
+    if (error) std::rethrow_exception(error);
+}
+
+void Worker_pool::work_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        work_ready_.wait(lock, [this] {
+            return stopping_ || (job_ && next_ < count_);
+        });
+        if (stopping_) return;
+
+        take_jobs_(lock);
+    }
+}
+
+void Worker_pool::take_jobs_(std::unique_lock<std::mutex>& lock)
+{
+    while (job_ && next_ < count_) {
+        size_t index = next_++;
+        auto const& job = *job_;
+        lock.unlock();
+
+        in_job = true;
+        try {
+            GE211_TRACE_SCOPE("ge211", "parallel_for job");
+            job(index);
+        } catch (...) {
+            lock.lock();
+            if (!error_) error_ = std::current_exception();
+            lock.unlock();
+        }
+        in_job = false;
+
+        lock.lock();
+        if (++finished_ == count_) work_done_.notify_all();
+    }
+}
+
+} // end anonymous namespace
+
+void parallel_for(size_t count, std::function<void(size_t)> const& job)
+{
+    if (count == 0) return;
+
+    if (count == 1 || in_job || Worker_pool::instance().size() == 0) {
+        for (size_t i = 0; i < count; ++i) job(i);
+        return;
+    }
+
+    Worker_pool::instance().run(count, job);
+}
+
+}
@@ -0,0 +1,360 @@
+#include "ge211_profile.hxx"
+#include "ge211_error.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ge211 {
+
+namespace profile {
+
+const size_t Frame_timing::capacity;
+const size_t Frame_timing::phase_count;
+const size_t Tracer::events_per_thread;
+
+namespace {
+
+// Textures are created and destroyed on the main thread, but read from
+// anywhere.
+std::atomic<long> texture_count{0};
+std::atomic<long> texture_bytes{0};
+
+// The frame length the engine aims for without vsync.
+const double default_budget_seconds = 1.0 / 60;
+
+// The given percentile of the samples, which it reorders.
+double percentile_of(std::vector<float>& samples, double percent)
+{
+    if (samples.empty()) return 0;
+
+    percent = std::max(0.0, std::min(100.0, percent));
+    auto rank = size_t(std::ceil(percent / 100 * double(samples.size())));
+    auto nth = samples.begin() + std::max(rank, size_t(1)) - 1;
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+// How each phase appears in traces.
+char const* const phase_names[Frame_timing::phase_count] = {
+        "events",
+        "on_frame",
+        "poll_channels",
+        "draw",
+        "paint",
+        "present",
+        "sleep",
+};
+
+} // end anonymous namespace
+
+Texture_usage texture_usage() NOEXCEPT
+{
+    return {texture_count.load(std::memory_order_relaxed),
+            texture_bytes.load(std::memory_order_relaxed)};
+}
+
+Frame_timing::Frame_timing() NOEXCEPT
+        : samples_{},
+          next_{0},
+          count_{0},
+          budget_{default_budget_seconds},
+          over_budget_{0},
+          total_{0},
+          frame_start_{Time_point::now()},
+          phase_start_{frame_start_}
+{ }
+
+size_t Frame_timing::frame_count() const NOEXCEPT
+{
+    return count_;
+}
+
+Duration Frame_timing::last(Frame_phase phase) const NOEXCEPT
+{
+    if (count_ == 0) return Duration();
+
+    size_t previous = (next_ + capacity - 1) % capacity;
+    return Duration(samples_[size_t(phase)][previous]);
+}
+
+Duration Frame_timing::percentile(Frame_phase phase, double percent) const
+{
+    std::vector<float> samples(samples_[size_t(phase)],
+                               samples_[size_t(phase)] + count_);
+    return Duration(percentile_of(samples, percent));
+}
+
+Duration Frame_timing::work_percentile(double percent) const
+{
+    std::vector<float> samples(count_, 0);
+    for (size_t phase = 0; phase < phase_count; ++phase) {
+        if (phase == size_t(Frame_phase::sleep)) continue;
+        for (size_t i = 0; i < count_; ++i) {
+            samples[i] += samples_[phase][i];
+        }
+    }
+    return Duration(percentile_of(samples, percent));
+}
+
+Duration Frame_timing::budget() const NOEXCEPT
+{
+    return budget_;
+}
+
+void Frame_timing::set_budget(Duration budget) NOEXCEPT
+{
+    budget_ = budget;
+}
+
+long Frame_timing::over_budget_count() const NOEXCEPT
+{
+    return over_budget_;
+}
+
+long Frame_timing::total_frame_count() const NOEXCEPT
+{
+    return total_;
+}
+
+void Frame_timing::reset() NOEXCEPT
+{
+    next_ = 0;
+    count_ = 0;
+    over_budget_ = 0;
+    total_ = 0;
+}
+
+void Frame_timing::start_frame_() NOEXCEPT
+{
+    frame_start_ = phase_start_ = Time_point::now();
+}
+
+void Frame_timing::end_phase_(Frame_phase phase) NOEXCEPT
+{
+    auto now = Time_point::now();
+    samples_[size_t(phase)][next_] = float((now - phase_start_).seconds());
+    Tracer::instance().record("ge211", phase_names[size_t(phase)],
+                              phase_start_, now);
+    phase_start_ = now;
+}
+
+void Frame_timing::end_frame_() NOEXCEPT
+{
+    end_phase_(Frame_phase::sleep);
+
+    float work = 0;
+    for (size_t phase = 0; phase < phase_count; ++phase) {
+        if (phase != size_t(Frame_phase::sleep))
+            work += samples_[phase][next_];
+    }
+    if (work > budget_.seconds()) ++over_budget_;
+    ++total_;
+
+    Tracer::instance().record("ge211", "frame", frame_start_, phase_start_);
+    frame_start_ = phase_start_;
+
+    next_ = (next_ + 1) % capacity;
+    count_ = std::min(count_ + 1, capacity);
+}
+
+namespace {
+
+struct Trace_event
+{
+    char const* category;
+    char const* name;
+    Time_point start;
+    Time_point end;
+};
+
+// One thread's events. Only its own thread writes to it, so recording
+// needs no lock: the thread fills in the next slot and then publishes it
+// by bumping `written`.
+struct Thread_buffer
+{
+    explicit Thread_buffer(int tid)
+            : events(Tracer::events_per_thread),
+              written{0},
+              tid{tid}
+    { }
+
+    std::vector<Trace_event> events;
+    std::atomic<uint64_t> written;
+    int tid;
+};
+
+// Every thread's buffer, kept after the thread ends so that its events
+// can still be written. The lock is only taken when a thread records its
+// first event, and when writing.
+std::mutex& buffers_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::shared_ptr<Thread_buffer>>& all_buffers()
+{
+    static std::vector<std::shared_ptr<Thread_buffer>> buffers;
+    return buffers;
+}
+
+Thread_buffer& this_thread_buffer()
+{
+    thread_local std::shared_ptr<Thread_buffer> buffer;
+
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffers_mutex());
+        auto& buffers = all_buffers();
+        buffer = std::make_shared<Thread_buffer>(int(buffers.size()) + 1);
+        buffers.push_back(buffer);
+    }
+
+    return *buffer;
+}
+
+void write_json_string(std::ostream& out, char const* str)
+{
+    out << '"';
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') out << '\\';
+        out << *str;
+    }
+    out << '"';
+}
+
+} // end anonymous namespace
+
+Tracer::Tracer() NOEXCEPT
+        : recording_{false},
+          epoch_{Time_point::now()}
+{ }
+
+Tracer& Tracer::instance() NOEXCEPT
+{
+    static Tracer instance;
+    return instance;
+}
+
+void Tracer::start(std::string filename)
+{
+    filename_ = std::move(filename);
+    recording_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop() NOEXCEPT
+{
+    recording_.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::record(char const* category,
+                    char const* name,
+                    Time_point start,
+                    Time_point end) NOEXCEPT
+{
+    if (!is_recording()) return;
+
+    Thread_buffer* buffer;
+    try {
+        buffer = &this_thread_buffer();
+    } catch (...) {
+        return;
+    }
+
+    uint64_t n = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[n % events_per_thread] = {category, name, start, end};
+    buffer->written.store(n + 1, std::memory_order_release);
+}
+
+bool Tracer::write() const
+{
+    if (filename_.empty()) {
+        internal::logging::warn()
+            << "Tracer::write: no file to write to; call start() first";
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Thread_buffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex());
+        buffers = all_buffers();
+    }
+
+    std::ofstream out(filename_);
+    out << std::fixed << std::setprecision(3)
+        << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    std::vector<Trace_event> events;
+
+    for (auto const& buffer : buffers) {
+        // Copy out the newest events. The thread may keep recording while
+        // we copy, overwriting the oldest ones; those are dropped after.
+        uint64_t end = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = end > events_per_thread ? end - events_per_thread : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; ++i) {
+            events.push_back(buffer->events[i % events_per_thread]);
+        }
+        // Event `now` may be half written, into the slot that held event
+        // `now - events_per_thread`, so that one goes too.
+        uint64_t now = buffer->written.load(std::memory_order_acquire);
+        uint64_t intact = now >= events_per_thread
+                          ? now - events_per_thread + 1
+                          : 0;
+        if (intact > begin) {
+            uint64_t lost = intact - begin;
+            events.erase(events.begin(),
+                         events.begin() + std::min(size_t(lost), events.size()));
+        }
+
+        for (Trace_event const& event : events) {
+            out << (first? "" : ",\n") << "{\"cat\":";
+            write_json_string(out, event.category);
+            out << ",\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << (event.start - epoch_).seconds() * 1e6
+                << ",\"dur\":" << (event.end - event.start).seconds() * 1e6
+                << "}";
+            first = false;
+        }
+    }
+
+    out << "\n]}\n";
+    out.close();
+
+    if (!out) {
+        internal::logging::warn()
+            << "Tracer::write: could not write trace to " << filename_;
+        return false;
+    }
+
+    internal::logging::info()
+        << "Wrote trace to " << filename_;
+    return true;
+}
+
+} // end namespace profile
+
+namespace detail {
+
+void note_texture_created(long bytes) NOEXCEPT
+{
+    profile::texture_count.fetch_add(1, std::memory_order_relaxed);
+    profile::texture_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void note_texture_destroyed(long bytes) NOEXCEPT
+{
+    profile::texture_count.fetch_sub(1, std::memory_order_relaxed);
+    profile::texture_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+} // end namespace detail
+
+}
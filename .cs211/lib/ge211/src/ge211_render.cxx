@@ -1,9 +1,15 @@
 #include "ge211_render.hxx"
 #include "ge211_error.hxx"
+#include "ge211_profile.hxx"
 #include "ge211_util.hxx"
 
 #include <SDL.h>
+#include <SDL_ttf.h>
+#include "utf8.h"
 
+#include <algorithm>
+#include <iterator>
+#include <string>
 #include <utility>
 
 static inline SDL_RendererFlip&
@@ -40,8 +46,41 @@ static const Renderer_flag renderer_flags_to_try[] = {
 
 #pragma pop_macro("RF")
 
+// Roughly how much video memory a texture takes: we assume 4 bytes per
+// pixel, since that's what all of ours are.
+long texture_bytes(SDL_Texture* texture)
+{
+    int width = 0, height = 0;
+    SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+    return 4L * width * height;
+}
+
 } // end anonymous namespace
 
+SDL_Texture* create_texture_from_surface(SDL_Renderer* renderer,
+                                         SDL_Surface* surface)
+{
+    SDL_Texture* result = SDL_CreateTextureFromSurface(renderer, surface);
+    if (result) note_texture_created(texture_bytes(result));
+    return result;
+}
+
+SDL_Texture* create_texture(SDL_Renderer* renderer,
+                            uint32_t format, int access,
+                            int width, int height)
+{
+    SDL_Texture* result = SDL_CreateTexture(renderer, format, access,
+                                            width, height);
+    if (result) note_texture_created(texture_bytes(result));
+    return result;
+}
+
+void destroy_texture(SDL_Texture* texture)
+{
+    note_texture_destroyed(texture_bytes(texture));
+    SDL_DestroyTexture(texture);
+}
+
 SDL_Renderer* Renderer::create_renderer_(SDL_Window* window)
 {
     SDL_Renderer* result;
@@ -81,6 +120,8 @@ bool Renderer::is_vsync() const NOEXCEPT
 
 void Renderer::clear()
 {
+    flush();
+
     if (SDL_RenderClear(get_raw_()))
         throw Host_error{"Could not clear window"};
 }
@@ -98,8 +139,29 @@ void Renderer::set_color(Color color)
         throw Host_error{"Could not set renderer color"};
 }
 
+void Renderer::fill_rectangle(const Rect<int>& rect, Color color)
+{
+    if (rect.width <= 0 || rect.height <= 0) return;
+
+#if GE211_BATCH_GEOMETRY
+    batch_quad_(nullptr,
+                float(rect.x), float(rect.y),
+                float(rect.x + rect.width), float(rect.y + rect.height),
+                0, 0, 0, 0,
+                color);
+#else
+    set_color(color);
+
+    SDL_Rect sdl_rect = rect;
+    if (SDL_RenderFillRect(get_raw_(), &sdl_rect) < 0) {
+        warn_sdl() << "Could not fill rectangle";
+    }
+#endif
+}
+
 void Renderer::present() NOEXCEPT
 {
+    flush();
     SDL_RenderPresent(get_raw_());
 }
 
@@ -109,12 +171,26 @@ void Renderer::copy(const Texture& texture, Posn<int> xy)
     if (!raw_texture) return;
 
     SDL_Rect dstrect = Rect<int>::from_top_left(xy, texture.dimensions());
-
+    Rect<int> source = texture.source_rect_();
+
+#if GE211_BATCH_GEOMETRY
+    Dims<int> sheet = texture.sheet_dimensions_();
+    batch_quad_(raw_texture,
+                float(dstrect.x), float(dstrect.y),
+                float(dstrect.x + dstrect.w), float(dstrect.y + dstrect.h),
+                float(source.x) / float(sheet.width),
+                float(source.y) / float(sheet.height),
+                float(source.x + source.width) / float(sheet.width),
+                float(source.y + source.height) / float(sheet.height),
+                Color::white());
+#else
+    SDL_Rect srcrect = source;
     int render_result = SDL_RenderCopy(get_raw_(), raw_texture,
-                                       nullptr, &dstrect);
+                                       &srcrect, &dstrect);
     if (render_result < 0) {
         warn_sdl() << "Could not render texture";
     }
+#endif
 }
 
 void Renderer::copy(const Texture& texture,
@@ -133,16 +209,40 @@ void Renderer::copy(const Texture& texture,
     if (transform.get_flip_v()) flip |= SDL_FLIP_VERTICAL;
 
     auto rotation = transform.get_rotation();
+    Rect<int> source = texture.source_rect_();
+
+#if GE211_BATCH_GEOMETRY
+    // Flips just swap texture coordinates; only rotation needs
+    // SDL_RenderCopyEx.
+    if (rotation == 0) {
+        Dims<int> sheet = texture.sheet_dimensions_();
+        float u0 = float(source.x) / float(sheet.width),
+              u1 = float(source.x + source.width) / float(sheet.width),
+              v0 = float(source.y) / float(sheet.height),
+              v1 = float(source.y + source.height) / float(sheet.height);
+        if (flip & SDL_FLIP_HORIZONTAL) std::swap(u0, u1);
+        if (flip & SDL_FLIP_VERTICAL) std::swap(v0, v1);
+        batch_quad_(raw_texture,
+                    float(dstrect.x), float(dstrect.y),
+                    float(dstrect.x + dstrect.w), float(dstrect.y + dstrect.h),
+                    u0, v0, u1, v1,
+                    Color::white());
+        return;
+    }
 
+    flush();
+#endif
+
+    SDL_Rect srcrect = source;
     int render_result;
     if (rotation == 0 && flip == SDL_FLIP_NONE) {
         render_result = SDL_RenderCopy(
                 get_raw_(), raw_texture,
-                nullptr, &dstrect);
+                &srcrect, &dstrect);
     } else {
         render_result = SDL_RenderCopyEx(
                 get_raw_(), raw_texture,
-                nullptr, &dstrect,
+                &srcrect, &dstrect,
                 transform.get_rotation(), nullptr,
                 flip);
     }
@@ -152,6 +252,107 @@ void Renderer::copy(const Texture& texture,
     }
 }
 
+void Renderer::copy_glyphs(Glyph_atlas& atlas,
+                           const std::vector<Rect<int>>& cells,
+                           Posn<int> xy,
+                           Color color,
+                           double scale_x,
+                           double scale_y)
+{
+    if (cells.empty()) return;
+
+    auto raw_texture = atlas.get_raw_(*this);
+    if (!raw_texture) return;
+
+    float x = float(xy.x);
+    float top = float(xy.y);
+    float bottom = top + float(atlas.line_height() * scale_y);
+
+#if GE211_BATCH_GEOMETRY
+    float atlas_w = float(atlas.texture_dims_.width);
+    float atlas_h = float(atlas.texture_dims_.height);
+
+    for (const Rect<int>& cell : cells) {
+        float right = x + float(cell.width * scale_x);
+        if (cell.width > 0) {
+            batch_quad_(raw_texture,
+                        x, top, right, bottom,
+                        float(cell.x) / atlas_w,
+                        float(cell.y) / atlas_h,
+                        float(cell.x + cell.width) / atlas_w,
+                        float(cell.y + cell.height) / atlas_h,
+                        color);
+        }
+        x = right;
+    }
+#else
+    SDL_SetTextureColorMod(raw_texture,
+                           color.red(), color.green(), color.blue());
+    SDL_SetTextureAlphaMod(raw_texture, color.alpha());
+
+    for (const Rect<int>& cell : cells) {
+        float right = x + float(cell.width * scale_x);
+        if (cell.width > 0) {
+            SDL_Rect srcrect = cell;
+            SDL_Rect dstrect{int(x), int(top),
+                             int(right) - int(x), int(bottom) - int(top)};
+            if (SDL_RenderCopy(get_raw_(), raw_texture,
+                               &srcrect, &dstrect) < 0) {
+                warn_sdl() << "Could not render glyph";
+                break;
+            }
+        }
+        x = right;
+    }
+#endif
+}
+
+#if GE211_BATCH_GEOMETRY
+
+void Renderer::batch_quad_(SDL_Texture* texture,
+                           float x0, float y0, float x1, float y1,
+                           float u0, float v0, float u1, float v1,
+                           Color color)
+{
+    if (texture != batch_texture_) {
+        flush();
+        batch_texture_ = texture;
+    }
+
+    SDL_Color tint{color.red(), color.green(), color.blue(), color.alpha()};
+
+    int base = int(batch_vertices_.size());
+    batch_vertices_.push_back(SDL_Vertex{{x0, y0}, tint, {u0, v0}});
+    batch_vertices_.push_back(SDL_Vertex{{x1, y0}, tint, {u1, v0}});
+    batch_vertices_.push_back(SDL_Vertex{{x0, y1}, tint, {u0, v1}});
+    batch_vertices_.push_back(SDL_Vertex{{x1, y1}, tint, {u1, v1}});
+    for (int i : {0, 1, 2, 2, 1, 3})
+        batch_indices_.push_back(base + i);
+}
+
+void Renderer::flush()
+{
+    if (batch_vertices_.empty()) return;
+
+    if (SDL_RenderGeometry(get_raw_(), batch_texture_,
+                           batch_vertices_.data(),
+                           int(batch_vertices_.size()),
+                           batch_indices_.data(),
+                           int(batch_indices_.size())) < 0) {
+        warn_sdl() << "Could not render batched geometry";
+    }
+
+    batch_vertices_.clear();
+    batch_indices_.clear();
+}
+
+#else
+
+void Renderer::flush()
+{ }
+
+#endif
+
 void Renderer::prepare(const Texture& texture) const
 {
     texture.get_raw_(*this);
@@ -184,14 +385,19 @@ Texture::Texture(Uniq_SDL_Surface surface)
         : impl_(std::make_shared<Impl_>(std::move(surface)))
 { }
 
+Texture::Texture(const Texture& sheet, const Rect<int>& region) NOEXCEPT
+        : impl_(sheet.impl_),
+          region_(region)
+{ }
+
 SDL_Texture* Texture::get_raw_(const Renderer& renderer) const
 {
     if (impl_->texture_) return impl_->texture_.get();
 
     if (!impl_->surface_) return nullptr;
 
-    SDL_Texture* raw = SDL_CreateTextureFromSurface(renderer.get_raw_(),
-                                                    impl_->surface_.get());
+    SDL_Texture* raw = create_texture_from_surface(renderer.get_raw_(),
+                                                   impl_->surface_.get());
     if (raw) {
         *impl_ = Impl_(raw);
         return raw;
@@ -201,6 +407,13 @@ SDL_Texture* Texture::get_raw_(const Renderer& renderer) const
 }
 
 Dims<int> Texture::dimensions() const NOEXCEPT
+{
+    if (region_.width > 0) return region_.dimensions();
+
+    return sheet_dimensions_();
+}
+
+Dims<int> Texture::sheet_dimensions_() const NOEXCEPT
 {
     Dims<int> result{0, 0};
 
@@ -215,8 +428,17 @@ Dims<int> Texture::dimensions() const NOEXCEPT
     return result;
 }
 
+Rect<int> Texture::source_rect_() const NOEXCEPT
+{
+    if (region_.width > 0) return region_;
+
+    return Rect<int>::from_top_left({0, 0}, sheet_dimensions_());
+}
+
 Borrowed<SDL_Surface> Texture::raw_surface() NOEXCEPT
 {
+    if (region_.width > 0) return nullptr;
+
     return impl_->surface_.get();
 }
 
@@ -225,6 +447,266 @@ bool Texture::empty() const NOEXCEPT
     return impl_ == nullptr;
 }
 
+Texture::Weak::Weak() NOEXCEPT
+{ }
+
+Texture::Weak::Weak(const Texture& texture) NOEXCEPT
+        : impl_(texture.impl_),
+          region_(texture.region_)
+{ }
+
+Texture Texture::Weak::lock() const NOEXCEPT
+{
+    Texture result;
+    result.impl_ = std::static_pointer_cast<Impl_>(impl_.lock());
+    if (result.impl_) result.region_ = region_;
+    return result;
+}
+
+bool Texture::Weak::expired() const NOEXCEPT
+{
+    return impl_.expired();
+}
+
+namespace {
+
+// Transparent pixels left between packed textures, so that scaled copies
+// don't pick up the edge of a neighbor.
+const int texture_sheet_padding = 1;
+
+} // end anonymous namespace
+
+size_t Texture::pack(const std::vector<Texture*>& textures,
+                     Dims<int> sheet_dims,
+                     int max_side)
+{
+    // One entry per distinct surface, with every Texture sharing it.
+    struct Entry
+    {
+        std::shared_ptr<Impl_> impl;
+        std::vector<Texture*> users;
+        size_t sheet;
+        Rect<int> region;
+    };
+
+    std::vector<Entry> entries;
+    std::unordered_map<Impl_*, size_t> entry_of;
+
+    for (Texture* texture : textures) {
+        if (texture->empty() || texture->region_.width > 0) continue;
+
+        SDL_Surface* surface = texture->impl_->surface_.get();
+        if (!surface) continue;
+        if (surface->w > max_side || surface->h > max_side) continue;
+
+        auto found = entry_of.find(texture->impl_.get());
+        if (found == entry_of.end()) {
+            entry_of[texture->impl_.get()] = entries.size();
+            entries.push_back(Entry{texture->impl_, {texture}, 0, {}});
+        } else {
+            entries[found->second].users.push_back(texture);
+        }
+    }
+
+    if (entries.empty()) return 0;
+
+    // Shelf packing: tallest first, left to right in rows as tall as
+    // their first texture. First just find where everything goes, so
+    // each sheet can be made only as tall as it needs to be.
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entries[a].impl->surface_->h > entries[b].impl->surface_->h;
+    });
+
+    std::vector<int> sheet_heights{0};
+    Posn<int> cursor{0, 0};
+    int shelf_height = 0;
+
+    for (size_t i : order) {
+        Entry& entry = entries[i];
+        int width  = entry.impl->surface_->w + texture_sheet_padding;
+        int height = entry.impl->surface_->h + texture_sheet_padding;
+
+        if (cursor.x + width > sheet_dims.width) {
+            cursor = {0, cursor.y + shelf_height};
+            shelf_height = 0;
+        }
+        if (cursor.y + height > sheet_dims.height) {
+            sheet_heights.push_back(0);
+            cursor = {0, 0};
+            shelf_height = 0;
+        }
+
+        entry.sheet  = sheet_heights.size() - 1;
+        entry.region = {cursor.x, cursor.y,
+                        entry.impl->surface_->w, entry.impl->surface_->h};
+
+        cursor.x += width;
+        shelf_height = std::max(shelf_height, height);
+        sheet_heights.back() = std::max(sheet_heights.back(),
+                                        cursor.y + shelf_height);
+    }
+
+    // Then copy the surfaces over.
+    std::vector<Texture> sheets;
+    for (int height : sheet_heights) {
+        SDL_Surface* raw = SDL_CreateRGBSurfaceWithFormat(
+                0, sheet_dims.width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!raw)
+            throw Host_error{"Could not create texture sheet"};
+        sheets.emplace_back(Uniq_SDL_Surface(raw));
+    }
+
+    for (Entry& entry : entries) {
+        SDL_Surface* surface = entry.impl->surface_.get();
+        SDL_Rect dstrect{entry.region.x, entry.region.y,
+                         entry.region.width, entry.region.height};
+        // Copy alpha as is, rather than blending it in.
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        if (SDL_BlitSurface(surface, nullptr,
+                            sheets[entry.sheet].impl_->surface_.get(),
+                            &dstrect) < 0)
+            throw Host_error{"Could not copy texture to sheet"};
+
+        for (Texture* user : entry.users) {
+            *user = Texture(sheets[entry.sheet], entry.region);
+        }
+    }
+
+    return sheets.size();
+}
+
+namespace {
+
+// Glyphs are packed into rows of an atlas this wide, unless one glyph is
+// wider still.
+const int glyph_atlas_width = 512;
+
+} // end anonymous namespace
+
+Glyph_atlas::Glyph_atlas(TTF_Font* font)
+        : font_{font},
+          line_height_{std::max(1, TTF_FontHeight(font))},
+          texture_dims_{0, 0},
+          dirty_{false},
+          cursor_{0, 0}
+{
+    grow_(glyph_atlas_width);
+}
+
+int Glyph_atlas::line_height() const NOEXCEPT
+{
+    return line_height_;
+}
+
+Rect<int> Glyph_atlas::glyph(uint32_t code_point)
+{
+    if (code_point < 128) {
+        Rect<int>& cell = ascii_[code_point];
+        if (cell.height == 0) cell = add_glyph_(code_point);
+        return cell;
+    }
+
+    auto found = others_.find(code_point);
+    if (found != others_.end()) return found->second;
+
+    return others_[code_point] = add_glyph_(code_point);
+}
+
+Rect<int> Glyph_atlas::add_glyph_(uint32_t code_point)
+{
+    std::string utf8;
+    try {
+        utf8::append(code_point, std::back_inserter(utf8));
+    } catch (const utf8::exception&) {
+        return {0, 0, 0, line_height_};
+    }
+
+    Uniq_SDL_Surface rendered{
+            TTF_RenderUTF8_Blended(font_, utf8.c_str(),
+                                   SDL_Color{255, 255, 255, 255})};
+    if (!rendered || rendered->w <= 0) {
+        return {0, 0, 0, line_height_};
+    }
+
+    int width = rendered->w;
+    if (cursor_.x + width > surface_->w) {
+        cursor_ = {0, cursor_.y + line_height_};
+    }
+    if (cursor_.y + line_height_ > surface_->h || width > surface_->w) {
+        grow_(width);
+    }
+
+    Rect<int> cell{cursor_.x, cursor_.y, width, line_height_};
+    SDL_Rect dstrect = cell;
+    // Copy the glyph's alpha as is, rather than blending it in.
+    SDL_SetSurfaceBlendMode(rendered.get(), SDL_BLENDMODE_NONE);
+    if (SDL_BlitSurface(rendered.get(), nullptr, surface_.get(), &dstrect) < 0)
+        throw Host_error{"Could not add glyph to atlas"};
+
+    cursor_.x += width;
+    dirty_ = true;
+    return cell;
+}
+
+void Glyph_atlas::grow_(int min_width)
+{
+    int width = std::max(min_width, glyph_atlas_width);
+    int height = 4 * line_height_;
+    if (surface_) {
+        width = std::max(width, surface_->w);
+        height = 2 * surface_->h;
+    }
+
+    SDL_Surface* raw = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                      SDL_PIXELFORMAT_ARGB8888);
+    if (!raw)
+        throw Host_error{"Could not create glyph atlas"};
+    Uniq_SDL_Surface bigger{raw};
+
+    if (surface_) {
+        SDL_SetSurfaceBlendMode(surface_.get(), SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(surface_.get(), nullptr, bigger.get(), nullptr);
+    }
+
+    surface_ = std::move(bigger);
+    dirty_ = true;
+}
+
+SDL_Texture* Glyph_atlas::get_raw_(Renderer& renderer)
+{
+    Dims<int> dims{surface_->w, surface_->h};
+
+    if (!texture_ || texture_dims_ != dims) {
+        // The renderer may have quads batched with the old texture.
+        renderer.flush();
+
+        SDL_Texture* raw = create_texture(renderer.get_raw_(),
+                                          SDL_PIXELFORMAT_ARGB8888,
+                                          SDL_TEXTUREACCESS_STATIC,
+                                          dims.width, dims.height);
+        if (!raw) {
+            warn_sdl() << "Could not create glyph atlas texture";
+            return nullptr;
+        }
+        SDL_SetTextureBlendMode(raw, SDL_BLENDMODE_BLEND);
+        texture_ = raw;
+        texture_dims_ = dims;
+        dirty_ = true;
+    }
+
+    if (dirty_) {
+        if (SDL_UpdateTexture(texture_.get(), nullptr,
+                              surface_->pixels, surface_->pitch) < 0) {
+            warn_sdl() << "Could not update glyph atlas texture";
+        }
+        dirty_ = false;
+    }
+
+    return texture_.get();
+}
+
 } // end namespace detail
 
 }
@@ -1,12 +1,26 @@
 #include "ge211_resource.hxx"
+#include "ge211_bundle.hxx"
 #include "ge211_error.hxx"
+#include "ge211_render.hxx"
 #include "ge211_session.hxx"
 
 #include <SDL.h>
 #include <SDL_ttf.h>
 
+#include <atomic>
+#include <cstring>
 #include <ios>
+#include <iterator>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace ge211 {
 
@@ -77,10 +91,292 @@ open_binary_resource_file(std::string const& filename)
     return open_resource_<ifstream_opener<true>>(filename);
 }
 
+namespace {
+
+// The whole contents of a resource file, mapped into memory where the
+// platform allows, or else read into a buffer. Either way, the bytes stay
+// where they are until the object is destroyed.
+class Resource_bytes
+{
+public:
+    // Returns null if the file can't be opened.
+    static std::unique_ptr<Resource_bytes> load(std::string const& path);
+
+    ~Resource_bytes();
+
+    const void* data() const NOEXCEPT
+    { return mapped_ ? mapped_ : buffer_.data(); }
+
+    size_t size() const NOEXCEPT { return size_; }
+
+    Resource_bytes(Resource_bytes const&) = delete;
+    Resource_bytes& operator=(Resource_bytes const&) = delete;
+
+private:
+    Resource_bytes() = default;
+
+    void* mapped_ = nullptr;
+    std::vector<char> buffer_;
+    size_t size_ = 0;
+};
+
+std::unique_ptr<Resource_bytes> Resource_bytes::load(std::string const& path)
+{
+    std::unique_ptr<Resource_bytes> result(new Resource_bytes);
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    result->size_ = size_t(info.st_size);
+
+    if (result->size_ > 0) {
+        void* mapped = ::mmap(nullptr, result->size_, PROT_READ,
+                              MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) result->mapped_ = mapped;
+    }
+
+    ::close(fd);
+
+    if (result->mapped_ || result->size_ == 0) return result;
+#endif
+
+    // No mmap, or it failed, so read the file instead.
+    std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+    if (!in) return nullptr;
+
+    result->buffer_.assign(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>());
+    result->size_ = result->buffer_.size();
+    return result;
+}
+
+Resource_bytes::~Resource_bytes()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped_) ::munmap(mapped_, size_);
+#endif
+}
+
+// Where a resource's contents are in memory.
+struct Resource_span
+{
+    const void* data;
+    size_t size;
+};
+
+// A bundle of resources made by the `ge211_bundle` tool, mapped into
+// memory as a whole. See ge211_bundle.hxx for the format.
+class Resource_bundle
+{
+public:
+    // Returns null if there's no bundle at `path`. Logs a warning if there
+    // is a file but it isn't a bundle.
+    static std::unique_ptr<Resource_bundle> load(std::string const& path);
+
+    // Looks up a resource by name, with a binary search of the index.
+    bool find(std::string const& name, Resource_span&) const NOEXCEPT;
+
+private:
+    Resource_bundle(std::unique_ptr<Resource_bytes>, size_t count) NOEXCEPT;
+
+    uint64_t read_u64_(size_t position) const NOEXCEPT;
+    uint64_t entry_field_(size_t index, size_t field) const NOEXCEPT;
+    const char* bytes_() const NOEXCEPT;
+
+    std::unique_ptr<Resource_bytes> file_;
+    size_t count_;
+};
+
+std::unique_ptr<Resource_bundle>
+Resource_bundle::load(std::string const& path)
+{
+    auto file = Resource_bytes::load(path);
+    if (!file) return nullptr;
+
+    std::unique_ptr<Resource_bundle> result(new Resource_bundle(
+            std::move(file), 0));
+    size_t size = result->file_->size();
+
+    bool ok = size >= bundle_header_size
+              && std::memcmp(result->bytes_(), bundle_magic,
+                             sizeof bundle_magic) == 0;
+
+    if (ok) {
+        uint64_t count = result->read_u64_(sizeof bundle_magic);
+        ok = count <= (size - bundle_header_size) / bundle_entry_size;
+        if (ok) result->count_ = size_t(count);
+    }
+
+    // Every name and every file has to be inside the bundle.
+    for (size_t i = 0; ok && i < result->count_; ++i) {
+        for (size_t field : {1, 3}) {
+            uint64_t offset = result->entry_field_(i, field);
+            uint64_t length = result->entry_field_(i, field + 1);
+            ok = length <= size && offset <= size - length;
+            if (!ok) break;
+        }
+    }
+
+    if (!ok) {
+        internal::logging::warn()
+                << "Ignoring " << path << ", which is not a resource bundle";
+        return nullptr;
+    }
+
+    internal::logging::info()
+            << "Loaded " << result->count_ << " resources from " << path;
+    return result;
+}
+
+Resource_bundle::Resource_bundle(std::unique_ptr<Resource_bytes> file,
+                                 size_t count) NOEXCEPT
+        : file_{std::move(file)}
+        , count_{count}
+{ }
+
+bool Resource_bundle::find(std::string const& name,
+                           Resource_span& result) const NOEXCEPT
+{
+    uint64_t hash = bundle_hash(name.data(), name.size());
+
+    // Find the first entry with the hash...
+    size_t lo = 0, hi = count_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entry_field_(mid, 0) < hash) lo = mid + 1;
+        else hi = mid;
+    }
+
+    // ...and then the one with the name, in case of collisions.
+    for (; lo < count_ && entry_field_(lo, 0) == hash; ++lo) {
+        size_t name_offset = size_t(entry_field_(lo, 1));
+        size_t name_size = size_t(entry_field_(lo, 2));
+
+        if (name_size == name.size() &&
+            std::memcmp(bytes_() + name_offset, name.data(), name_size) == 0)
+        {
+            result.data = bytes_() + entry_field_(lo, 3);
+            result.size = size_t(entry_field_(lo, 4));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint64_t Resource_bundle::read_u64_(size_t position) const NOEXCEPT
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(bytes_() + position);
+
+    uint64_t result = 0;
+    for (int i = 7; i >= 0; --i) result = result << 8 | bytes[i];
+    return result;
+}
+
+uint64_t Resource_bundle::entry_field_(size_t index,
+                                       size_t field) const NOEXCEPT
+{
+    return read_u64_(bundle_header_size + index * bundle_entry_size
+                     + 8 * field);
+}
+
+const char* Resource_bundle::bytes_() const NOEXCEPT
+{
+    return static_cast<const char*>(file_->data());
+}
+
+// Finds resources, first in the bundle, if there is one, and then as
+// files. Every resource file opened so far is kept, by the name it was
+// asked for, so that each is found and mapped only once no matter how
+// many fonts, images and sounds are loaded from it. Files stay loaded
+// until exit, since fonts and music keep reading from their files for as
+// long as they're open.
+class Resource_cache
+{
+public:
+    static Resource_cache& instance()
+    {
+        static Resource_cache instance;
+        return instance;
+    }
+
+    // Returns false if the resource can't be found.
+    bool find(std::string const& filename, Resource_span& result)
+    {
+        if (bundle_ && bundle_->find(filename, result)) return true;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto iter = files_.find(filename);
+        if (iter == files_.end()) {
+            auto bytes = open_resource_<Opener>(filename);
+            if (!bytes) return false;
+            iter = files_.emplace(filename, std::move(bytes)).first;
+        }
+
+        result.data = iter->second->data();
+        result.size = iter->second->size();
+        return true;
+    }
+
+private:
+    struct Opener
+    {
+        using result_t = std::unique_ptr<Resource_bytes>;
+
+        static result_t open(std::string const& path)
+        {
+            return Resource_bytes::load(path);
+        }
+
+        static result_t fail(std::string const&)
+        {
+            return nullptr;
+        }
+    };
+
+    // Looks for the bundle next to the executable, and then in the working
+    // directory.
+    Resource_cache()
+    {
+        std::string base;
+        if (char* raw = SDL_GetBasePath()) {
+            base = raw;
+            SDL_free(raw);
+        }
+
+        bundle_ = Resource_bundle::load(base + bundle_filename);
+        if (!bundle_ && !base.empty())
+            bundle_ = Resource_bundle::load(bundle_filename);
+    }
+
+    // Never changes after construction, so it can be read without a lock.
+    std::unique_ptr<Resource_bundle> bundle_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Resource_bytes>> files_;
+};
+
+}  // end anonymous namespace
+
 namespace detail {
 
 static Owned<SDL_RWops> open_rwops_(const std::string& filename)
 {
+    Resource_span span;
+
+    // SDL won't make an SDL_RWops for an empty buffer, so empty files are
+    // opened the old way.
+    if (Resource_cache::instance().find(filename, span) && span.size > 0)
+        return SDL_RWFromConstMem(span.data, int(span.size));
+
     struct Opener
     {
         using result_t = Owned<SDL_RWops>;
@@ -113,18 +409,125 @@ void File_resource::close_rwops_(Owned<SDL_RWops> ptr)
 
 } // end namespace detail
 
+// Every font is opened on SDL_ttf's one FreeType library, which can't
+// open or close faces on two threads at once, so all opening and closing
+// holds this lock.
+static std::mutex& ttf_open_close_mutex_()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
 static Owned<TTF_Font> open_ttf_(const std::string& filename, int size)
 {
-    return TTF_OpenFontRW(File_resource(filename).release(), 1, size);
+    auto rwops = File_resource(filename).release();
+    std::lock_guard<std::mutex> lock(ttf_open_close_mutex_());
+    return TTF_OpenFontRW(rwops, 1, size);
 }
 
+namespace detail {
+
+// Every copy of one Font's TTF_Font, and which are free.
+class Font_handles
+{
+public:
+    Font_handles(std::string filename, int size)
+            : filename_{std::move(filename)}
+            , size_{size}
+    { }
+
+    ~Font_handles()
+    {
+        std::lock_guard<std::mutex> lock(ttf_open_close_mutex_());
+        for (auto raw : all_) TTF_CloseFont(raw);
+    }
+
+    std::string const& filename() const NOEXCEPT { return filename_; }
+
+    // Returns a free copy, or opens a new one, or returns null if it
+    // can't.
+    Owned<TTF_Font> acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                auto raw = idle_.back();
+                idle_.pop_back();
+                return raw;
+            }
+        }
+
+        // Opening takes a while, so don't hold this Font's lock (open_ttf_
+        // takes the lock that all opening shares).
+        auto raw = open_ttf_(filename_, size_);
+        if (raw) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            all_.push_back(raw);
+        }
+        return raw;
+    }
+
+    void release(Owned<TTF_Font> raw)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(raw);
+    }
+
+private:
+    std::string filename_;
+    int size_;
+
+    std::mutex mutex_;
+    std::vector<Owned<TTF_Font>> all_;
+    std::vector<Owned<TTF_Font>> idle_;
+};
+
+Font_lease::Font_lease(const Font& font)
+        : handles_{*font.handles_}
+        , raw_{handles_.acquire()}
+{
+    if (!raw_)
+        throw Font_error::could_not_load(handles_.filename());
+}
+
+Font_lease::~Font_lease()
+{
+    handles_.release(raw_);
+}
+
+} // end namespace detail
+
 Font::Font(const std::string& filename, int size)
-        : ptr_(open_ttf_(filename, size))
+        : handles_{new Font_handles(filename, size)}
 {
+    static std::atomic<unsigned long> next_id{0};
+    id_ = ++next_id;
+
     Session::check_session("Font loading");
 
-    if (!ptr_)
+    // Open the first copy now, to find out whether the font loads at all.
+    auto raw = handles_->acquire();
+    if (!raw)
         throw Font_error::could_not_load(filename);
+    handles_->release(raw);
+}
+
+Font::Font(Font&&) NOEXCEPT = default;
+Font& Font::operator=(Font&&) NOEXCEPT = default;
+Font::~Font() = default;
+
+std::shared_ptr<Glyph_atlas> Font::get_atlas_() const
+{
+    if (!atlas_) {
+        // The atlas keeps its copy for good, so no other thread can lease
+        // it.
+        auto raw = handles_->acquire();
+        if (!raw)
+            throw Font_error::could_not_load(handles_->filename());
+        atlas_ = std::make_shared<Glyph_atlas>(raw);
+    }
+
+    return atlas_;
 }
 
 }
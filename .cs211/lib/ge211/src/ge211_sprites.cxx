@@ -4,8 +4,12 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
+#include "utf8.h"
 
+#include <algorithm>
 #include <cmath>
+#include <map>
+#include <mutex>
 
 namespace ge211 {
 
@@ -29,14 +33,27 @@ Placed_sprite::Placed_sprite(const Sprite& sprite, Posn<int> xy,
         : sprite{&sprite}, xy{xy}, z{z}, transform{transform}
 { }
 
-void Placed_sprite::render(Renderer& dst) const
+bool Text_key::operator==(const Text_key& that) const
 {
-    sprite->render(dst, xy, transform);
+    return font_id == that.font_id &&
+           color == that.color &&
+           antialias == that.antialias &&
+           word_wrap == that.word_wrap &&
+           message == that.message;
+}
+
+bool Text_key::operator<(const Text_key& that) const
+{
+    if (font_id != that.font_id) return font_id < that.font_id;
+    if (color != that.color) return color < that.color;
+    if (antialias != that.antialias) return antialias < that.antialias;
+    if (word_wrap != that.word_wrap) return word_wrap < that.word_wrap;
+    return message < that.message;
 }
 
-bool operator<(const Placed_sprite& s1, const Placed_sprite& s2) NOEXCEPT
+void Placed_sprite::render(Renderer& dst) const
 {
-    return s1.z > s2.z;
+    sprite->render(dst, xy, transform);
 }
 
 Dims<int> Texture_sprite::dimensions() const
@@ -147,6 +164,35 @@ void Rectangle_sprite::recolor(Color color)
     *this = Rectangle_sprite{dimensions(), color};
 }
 
+Solid_rectangle_sprite::Solid_rectangle_sprite(Dims<int> dims, Color color)
+        : dimensions_{check_rectangle_dimensions(dims)},
+          color_{color}
+{ }
+
+void Solid_rectangle_sprite::recolor(Color color)
+{
+    color_ = color;
+}
+
+Color Solid_rectangle_sprite::color() const
+{
+    return color_;
+}
+
+Dims<int> Solid_rectangle_sprite::dimensions() const
+{
+    return dimensions_;
+}
+
+void Solid_rectangle_sprite::render(Renderer& renderer,
+                                    Posn<int> position,
+                                    const Transform& transform) const
+{
+    Dims<int> dims{int(dimensions_.width * transform.get_scale_x()),
+                   int(dimensions_.height * transform.get_scale_y())};
+    renderer.fill_rectangle(Rect<int>::from_top_left(position, dims), color_);
+}
+
 static Dims<int> compute_circle_dimensions(int radius)
 {
     if (radius <= 0) {
@@ -202,19 +248,76 @@ const Texture& Image_sprite::get_texture_() const
     return texture_;
 }
 
+namespace {
+
+// Text textures that exist somewhere, by what they were rendered from.
+// The cache doesn't keep them alive: entries for textures that every
+// Text_sprite has let go of are swept out as the map grows.
+std::map<Text_key, Texture::Weak>& text_cache()
+{
+    static std::map<Text_key, Texture::Weak> cache;
+    return cache;
+}
+
+// Text sprites can be made on several threads at once (see
+// parallel_for), so the cache is locked.
+std::mutex text_cache_mutex;
+
+size_t text_cache_sweep_at = 64;
+
+void sweep_text_cache()
+{
+    auto& cache = text_cache();
+    for (auto i = cache.begin(); i != cache.end(); ) {
+        if (i->second.expired())
+            i = cache.erase(i);
+        else
+            ++i;
+    }
+    text_cache_sweep_at = std::max(size_t(64), 2 * cache.size());
+}
+
+} // end anonymous namespace
+
+Text_key Text_sprite::make_key_(const Builder& config)
+{
+    Color c = config.color();
+    return Text_key{config.font().get_id_(),
+                config.message(),
+                uint32_t(c.red()) << 24 | uint32_t(c.green()) << 16 |
+                uint32_t(c.blue()) << 8 | uint32_t(c.alpha()),
+                config.antialias(),
+                config.word_wrap()};
+}
+
 Texture
-Text_sprite::create_texture(const Builder& config)
+Text_sprite::create_texture(const Text_key& key, const Builder& config)
 {
     SDL_Surface* raw;
 
-    std::string message = config.message();
+    std::string const& message = key.message;
 
     if (message.empty())
         return Texture{};
 
+    auto& cache = text_cache();
+
+    {
+        std::lock_guard<std::mutex> lock(text_cache_mutex);
+        auto found = cache.find(key);
+        if (found != cache.end()) {
+            Texture texture = found->second.lock();
+            if (!texture.empty()) return texture;
+        }
+    }
+
+    // Another thread may render the same text meanwhile; whichever
+    // finishes last ends up in the cache, which does no harm.
+    Font_lease font(config.font());
+
     if (config.word_wrap() > 0) {
         raw = TTF_RenderUTF8_Blended_Wrapped(
-                config.font().get_raw_(),
+                font.get_raw(),
                 message.c_str(),
                 config.color().to_sdl_(),
                 static_cast<uint32_t>(config.word_wrap()));
@@ -222,22 +325,30 @@ Text_sprite::create_texture(const Builder& config)
         auto render = config.antialias() ?
                       &TTF_RenderUTF8_Blended :
                       &TTF_RenderUTF8_Solid;
-        raw = render(config.font().get_raw_(),
+        raw = render(font.get_raw(),
                      message.c_str(),
                      config.color().to_sdl_());
     }
 
     if (!raw)
         throw Host_error{"Could not render text: “" + message + "”"};
-    else
-        return Texture{raw};
+
+    Texture texture{raw};
+
+    std::lock_guard<std::mutex> lock(text_cache_mutex);
+    if (cache.size() >= text_cache_sweep_at) sweep_text_cache();
+    cache[key] = Texture::Weak(texture);
+    return texture;
 }
 
 Text_sprite::Text_sprite(const Text_sprite::Builder& config)
-        : texture_{create_texture(config)} {}
+        : key_(make_key_(config))
+{
+    texture_ = create_texture(key_, config);
+}
 
 Text_sprite::Text_sprite()
-        : texture_{} {}
+        : texture_{}, key_{0, "", 0, false, 0} {}
 
 Text_sprite::Text_sprite(const std::string& message,
                          const Font& font)
@@ -322,7 +433,11 @@ int Text_sprite::Builder::word_wrap() const
 
 void Text_sprite::reconfigure(const Text_sprite::Builder& config)
 {
-    texture_ = create_texture(config);
+    Text_key key = make_key_(config);
+    if (key == key_ && !texture_.empty()) return;
+
+    texture_ = create_texture(key, config);
+    key_ = std::move(key);
 }
 
 bool Text_sprite::empty() const
@@ -335,6 +450,67 @@ Text_sprite::operator bool() const
     return !empty();
 }
 
+Glyph_text_sprite::Glyph_text_sprite(const Font& font, Color color)
+        : atlas_{font.get_atlas_()},
+          color_{color},
+          width_{0}
+{ }
+
+Glyph_text_sprite::Glyph_text_sprite(const std::string& message,
+                                     const Font& font,
+                                     Color color)
+        : Glyph_text_sprite{font, color}
+{
+    reconfigure(message);
+}
+
+void Glyph_text_sprite::reconfigure(const std::string& message)
+{
+    if (message == message_ && !cells_.empty()) return;
+
+    cells_.clear();
+    width_ = 0;
+
+    auto next = message.begin();
+    try {
+        while (next != message.end()) {
+            Rect<int> cell = atlas_->glyph(utf8::next(next, message.end()));
+            cells_.push_back(cell);
+            width_ += cell.width;
+        }
+    } catch (const utf8::exception&) {
+        cells_.clear();
+        width_ = 0;
+        message_.clear();
+        throw Client_logic_error{"Glyph_text_sprite: message is not UTF-8"};
+    }
+
+    message_ = message;
+}
+
+void Glyph_text_sprite::recolor(Color color)
+{
+    color_ = color;
+}
+
+const std::string& Glyph_text_sprite::message() const
+{
+    return message_;
+}
+
+Dims<int> Glyph_text_sprite::dimensions() const
+{
+    return {width_, atlas_->line_height()};
+}
+
+void Glyph_text_sprite::render(Renderer& renderer,
+                               Posn<int> position,
+                               const Transform& transform) const
+{
+    renderer.copy_glyphs(*atlas_, cells_, position, color_,
+                         transform.get_scale_x(), transform.get_scale_y());
+}
+
 void Multiplexed_sprite::reset()
 {
     since_.reset();
@@ -348,6 +524,42 @@ void Multiplexed_sprite::render(detail::Renderer& renderer,
     selection.render(renderer, position, transform);
 }
 
+Sprite_atlas::Sprite_atlas(Dims<int> sheet_dims, int max_side)
+        : sheet_dims_{sheet_dims},
+          max_side_{max_side}
+{
+    if (sheet_dims.width <= 0 || sheet_dims.height <= 0 || max_side <= 0) {
+        throw Client_logic_error(
+                "Sprite_atlas: dimensions must all be positive");
+    }
+
+    if (max_side >= sheet_dims.width || max_side >= sheet_dims.height) {
+        throw Client_logic_error(
+                "Sprite_atlas: max_side must fit in the sheet dimensions");
+    }
+}
+
+Sprite_atlas& Sprite_atlas::add(Sprite& sprite)
+{
+    auto text_sprite = dynamic_cast<Text_sprite*>(&sprite);
+    if (text_sprite && text_sprite->empty()) return *this;
+
+    auto texture_sprite = dynamic_cast<Texture_sprite*>(&sprite);
+    if (!texture_sprite) return *this;
+
+    // The sprite isn't const, so neither is its texture; pack() replaces
+    // it with the texture's place on a sheet.
+    textures_.push_back(&const_cast<Texture&>(texture_sprite->get_texture_()));
+    return *this;
+}
+
+size_t Sprite_atlas::pack()
+{
+    size_t sheets = Texture::pack(textures_, sheet_dims_, max_side_);
+    textures_.clear();
+    return sheets;
+}
+
 } // end namespace sprites
 
 }
@@ -0,0 +1,126 @@
+// Packs resource files into a bundle that ge211 can load them from. See
+// ge211_bundle.hxx for the format.
+//
+// Usage:
+//
+//     ge211_bundle OUTPUT [NAME FILE]...
+//
+// where each FILE is stored under NAME, the name that a game passes to
+// load it (e.g. `sans.ttf`). If a name is given more than once, the first
+// file wins, just as the first directory to have a file wins when ge211
+// searches for it.
+
+#include "ge211_bundle.hxx"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace ge211::detail;
+
+namespace {
+
+struct Entry
+{
+    std::string name;
+    std::vector<char> contents;
+    uint64_t hash;
+};
+
+void write_u64(std::ostream& out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        out.put(char(value & 0xFF));
+        value >>= 8;
+    }
+}
+
+bool read_file(std::string const& path, std::vector<char>& contents)
+{
+    std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+    if (!in) return false;
+
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+}  // end anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc % 2 != 0) {
+        std::cerr << "Usage: " << argv[0] << " OUTPUT [NAME FILE]...\n";
+        return 1;
+    }
+
+    std::vector<Entry> entries;
+    std::set<std::string> seen;
+
+    for (int i = 2; i < argc; i += 2) {
+        std::string name = argv[i];
+        if (!seen.insert(name).second) continue;
+
+        Entry entry;
+        entry.name = name;
+        entry.hash = bundle_hash(name.data(), name.size());
+
+        if (!read_file(argv[i + 1], entry.contents)) {
+            std::cerr << argv[0] << ": could not read " << argv[i + 1] << "\n";
+            return 1;
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](Entry const& a, Entry const& b) {
+                         return a.hash < b.hash;
+                     });
+
+    std::ofstream out(argv[1], std::ios_base::out | std::ios_base::binary);
+    if (!out) {
+        std::cerr << argv[0] << ": could not create " << argv[1] << "\n";
+        return 1;
+    }
+
+    out.write(bundle_magic, sizeof bundle_magic);
+    write_u64(out, entries.size());
+
+    // Names go right after the index, and contents after the names.
+    uint64_t position = bundle_header_size
+                        + bundle_entry_size * entries.size();
+    for (Entry const& entry : entries) position += entry.name.size();
+
+    uint64_t name_position = bundle_header_size
+                             + bundle_entry_size * entries.size();
+    for (Entry const& entry : entries) {
+        write_u64(out, entry.hash);
+        write_u64(out, name_position);
+        write_u64(out, entry.name.size());
+        write_u64(out, position);
+        write_u64(out, entry.contents.size());
+
+        name_position += entry.name.size();
+        position += entry.contents.size();
+    }
+
+    for (Entry const& entry : entries)
+        out.write(entry.name.data(), std::streamsize(entry.name.size()));
+
+    for (Entry const& entry : entries)
+        out.write(entry.contents.data(),
+                  std::streamsize(entry.contents.size()));
+
+    out.close();
+    if (!out) {
+        std::cerr << argv[0] << ": could not write " << argv[1] << "\n";
+        return 1;
+    }
+
+    return 0;
+}
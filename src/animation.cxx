@@ -0,0 +1,163 @@
+#include "animation.hxx"
+#include <algorithm>
+
+///
+/// EASING
+///
+
+double
+ease(Easing easing, double t)
+{
+    t = std::min(std::max(t, 0.0), 1.0);
+    double u = 1 - t;
+
+    switch (easing) {
+    case Easing::ease_out_cubic:
+        return 1 - u * u * u;
+    case Easing::ease_out_back:
+    {
+        // the usual overshoot constant, about 10% past the end
+        double const c = 1.70158;
+        return 1 + (c + 1) * -u * u * u + c * u * u;
+    }
+    case Easing::linear:
+    default:
+        return t;
+    }
+}
+
+///
+/// TWEEN
+///
+
+double
+Tween::progress(double now) const
+{
+    if (duration <= 0) {
+        return now >= start ? 1 : 0;
+    }
+    return ease(easing, (now - start) / duration);
+}
+
+bool
+Tween::finished(double now) const
+{
+    return now >= start + duration;
+}
+
+///
+/// ANIMATION
+///
+
+constexpr double Animation::slide_seconds;
+constexpr double Animation::pop_seconds;
+constexpr double Animation::spawn_seconds;
+
+void
+Animation::start_move(Model const& model)
+{
+    slides.clear();
+    pops.clear();
+    for (auto const& block : model.get_moving_blocks()) {
+        slides.push_back({block.get_start(), block.get_end(),
+                          block.get_val(), block.get_end_val()});
+        if (block.get_end_val() != 0) {
+            pops.push_back(block.get_end());
+        }
+    }
+
+    if (slides.empty()) {
+        finish();
+        return;
+    }
+
+    // the clock starts over with each move
+    now = 0;
+    slide = {0, slide_seconds, Easing::ease_out_cubic};
+    pop = {slide_seconds, pop_seconds, Easing::linear};
+    spawn = {slide_seconds, spawn_seconds, Easing::ease_out_back};
+    spawn_pos = model.get_new_spawn_pos();
+    version++;
+}
+
+void
+Animation::advance(double dt)
+{
+    if (is_animating()) {
+        now += dt;
+        version++;
+    }
+}
+
+void
+Animation::finish()
+{
+    if (is_animating()) {
+        version++;
+    }
+    now = std::max({now,
+                    slide.start + slide.duration,
+                    pop.start + pop.duration,
+                    spawn.start + spawn.duration});
+}
+
+bool
+Animation::is_animating() const
+{
+    return not (slide.finished(now) && pop.finished(now)
+                && spawn.finished(now));
+}
+
+unsigned long
+Animation::get_version() const
+{
+    return version;
+}
+
+bool
+Animation::is_sliding() const
+{
+    return not slides.empty() && not slide.finished(now);
+}
+
+std::vector<Animation::Slide> const&
+Animation::get_slides() const
+{
+    return slides;
+}
+
+ge211::Posn<float>
+Animation::slide_position(Slide const& s) const
+{
+    float p = float(slide.progress(now));
+    return {float(s.from.x) + p * float(s.to.x - s.from.x),
+            float(s.from.y) + p * float(s.to.y - s.from.y)};
+}
+
+Model::Position
+Animation::get_spawn_pos() const
+{
+    return spawn_pos;
+}
+
+double
+Animation::block_scale(Model::Position pos) const
+{
+    if (is_sliding()) {
+        return 1;
+    }
+
+    if (pos == spawn_pos && not spawn.finished(now)) {
+        return spawn.progress(now);
+    }
+
+    if (not pop.finished(now)
+        && std::find(pops.begin(), pops.end(), pos) != pops.end())
+    {
+        // up to 20% bigger halfway through, and back
+        double t = pop.progress(now);
+        return 1 + 0.4 * std::min(t, 1 - t);
+    }
+
+    return 1;
+}
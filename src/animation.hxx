@@ -0,0 +1,110 @@
+#pragma once
+
+#include "model.hxx"
+#include <vector>
+
+// time-based animation of the board. every tween works out where it is
+// from when it started and how long it lasts, instead of being stepped a
+// little each frame, so the animation looks the same at any frame rate,
+// never overshoots, and costs nothing for blocks that aren't looked at.
+// the model only records what a move did; this turns that into motion.
+
+/// EASING
+enum class Easing
+{
+    linear,
+    // fast start, slow finish
+    ease_out_cubic,
+    // like ease_out_cubic, but goes a little past the end and comes back
+    ease_out_back,
+};
+
+// maps progress from 0 to 1 onto eased progress. 0 maps to 0 and 1 to 1;
+// in between, ease_out_back can go over 1.
+double ease(Easing, double t);
+
+/// TWEEN
+// one animated change, on the animation's clock
+struct Tween
+{
+    // when it starts, in seconds
+    double start = 0;
+    // how long it lasts, in seconds
+    double duration = 0;
+    Easing easing = Easing::linear;
+
+    // eased progress at the given time: 0 until it starts, 1 once it ends
+    double progress(double now) const;
+    // whether it has ended by the given time
+    bool finished(double now) const;
+};
+
+/// ANIMATION
+class Animation
+{
+public:
+    // a block sliding from one board position to another during a move
+    struct Slide
+    {
+        Model::Position from;
+        Model::Position to;
+        // the value of the sliding block
+        int value;
+        // the value that was at `to` before the move: 0 if the block slid
+        // into an empty space, or the same as `value` if it merged
+        int end_val;
+    };
+
+    // how long each part of a move's animation takes, in seconds. blocks
+    // slide first; then merged blocks pop and the new block grows.
+    static constexpr double slide_seconds = 0.1;
+    static constexpr double pop_seconds = 0.15;
+    static constexpr double spawn_seconds = 0.15;
+
+    /// STARTING AND STOPPING
+    // starts animating the move the model just played, dropping whatever
+    // was still animating. a move that moved nothing starts nothing.
+    void start_move(Model const&);
+    // moves the animation's clock forward by dt seconds
+    void advance(double dt);
+    // jumps straight to the end
+    void finish();
+
+    /// GETTERS
+    // whether anything is still changing
+    bool is_animating() const;
+    // a counter that goes up whenever what the animation shows changes.
+    // if it is the same as last time, the animation looks the same too.
+    unsigned long get_version() const;
+
+    /// SLIDING
+    // whether the blocks are still sliding. while they are, the view
+    // should show the blocks in the middle of sliding instead of where
+    // they ended up.
+    bool is_sliding() const;
+    // the blocks that slid in the current move
+    std::vector<Slide> const& get_slides() const;
+    // where a sliding block is now, in board coordinates
+    ge211::Posn<float> slide_position(Slide const&) const;
+    // the board position of the block spawned by the current move
+    Model::Position get_spawn_pos() const;
+
+    /// POP AND GROW
+    // how much to scale the block at the given position by, once blocks
+    // have finished sliding: above 1 while a merged block pops, below 1
+    // while the new block grows in, and otherwise 1
+    double block_scale(Model::Position) const;
+
+private:
+    // seconds since the animation clock started
+    double now = 0;
+    unsigned long version = 0;
+
+    std::vector<Slide> slides;
+    std::vector<Model::Position> pops;
+    Model::Position spawn_pos {-1, -1};
+
+    Tween slide;
+    Tween pop;
+    Tween spawn;
+};
@@ -0,0 +1,141 @@
+#include "arena.hxx"
+#include <stdexcept>
+
+Session_arena::Session_arena(Packed_board::Rules const& rules)
+        : rules_(rules)
+{ }
+
+Session_arena::Handle
+Session_arena::create(uint64_t seed)
+{
+    uint32_t slot;
+    if (free_slots_.empty()) {
+        slot = uint32_t(boards_.size());
+        boards_.push_back(0);
+        scores_.push_back(0);
+        status_.push_back(0);
+        rngs_.push_back(0);
+        versions_.push_back(0);
+        live_slots_.push_back(true);
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        live_slots_[slot] = true;
+    }
+    live_++;
+
+    rngs_[slot] = seed;
+    Handle handle {slot, versions_[slot]};
+    new_game(handle);
+    return handle;
+}
+
+void
+Session_arena::destroy(Handle handle)
+{
+    uint32_t slot = check_(handle);
+    versions_[slot]++;
+    live_slots_[slot] = false;
+    free_slots_.push_back(slot);
+    live_--;
+}
+
+bool
+Session_arena::valid(Handle handle) const
+{
+    return handle.slot < boards_.size()
+           && live_slots_[handle.slot]
+           && versions_[handle.slot] == handle.version;
+}
+
+void
+Session_arena::new_game(Handle handle)
+{
+    uint32_t slot = check_(handle);
+    Packed_board::Rng rng(rngs_[slot]);
+    Packed_board board;
+    board.new_game(rng, rules_);
+    boards_[slot] = board.bits();
+    scores_[slot] = 0;
+    status_[slot] = uint8_t(board.game_over(rules_));
+    rngs_[slot] = rng.state;
+}
+
+bool
+Session_arena::play_move(Handle handle, Packed_board::Move move)
+{
+    uint32_t slot = check_(handle);
+    if (status_[slot] != 0) {
+        return false;
+    }
+
+    Packed_board board(boards_[slot]);
+    int reward = 0;
+    if (not board.play_move(move, reward)) {
+        return false;
+    }
+
+    Packed_board::Rng rng(rngs_[slot]);
+    board.spawn(rng, rules_);
+    boards_[slot] = board.bits();
+    scores_[slot] += uint32_t(reward);
+    status_[slot] = uint8_t(board.game_over(rules_));
+    rngs_[slot] = rng.state;
+    return true;
+}
+
+Packed_board
+Session_arena::get_board(Handle handle) const
+{
+    return Packed_board(boards_[check_(handle)]);
+}
+
+int
+Session_arena::get_val(Handle handle, Model::Position pos) const
+{
+    return get_board(handle).get_val(pos);
+}
+
+int
+Session_arena::get_score(Handle handle) const
+{
+    return int(scores_[check_(handle)]);
+}
+
+int
+Session_arena::get_game_over(Handle handle) const
+{
+    return status_[check_(handle)];
+}
+
+void
+Session_arena::reserve(size_t n)
+{
+    boards_.reserve(n);
+    scores_.reserve(n);
+    status_.reserve(n);
+    rngs_.reserve(n);
+    versions_.reserve(n);
+    live_slots_.reserve(n);
+}
+
+size_t
+Session_arena::memory_bytes() const
+{
+    return boards_.capacity() * sizeof(uint64_t)
+           + scores_.capacity() * sizeof(uint32_t)
+           + status_.capacity() * sizeof(uint8_t)
+           + rngs_.capacity() * sizeof(uint64_t)
+           + versions_.capacity() * sizeof(uint32_t)
+           + live_slots_.capacity() / 8
+           + free_slots_.capacity() * sizeof(uint32_t);
+}
+
+uint32_t
+Session_arena::check_(Handle handle) const
+{
+    if (not valid(handle)) {
+        throw std::invalid_argument("Session_arena: stale session handle");
+    }
+    return handle.slot;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "board.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a Session_arena holds the state of many games at once, for servers that
+// host millions of sessions. instead of one Model object per game (with its
+// 64-byte board, vectors and animation fields), each field lives in its own
+// contiguous pool indexed by slot (structure of arrays):
+//
+//   boards    8 bytes  Packed_board::bits
+//   scores    4 bytes
+//   status    1 byte   0 = playing, 1 = lost, 2 = won (like Model)
+//   rngs      8 bytes  Board_rng state, so spawns are reproducible
+//   versions  4 bytes  bumped when a slot is freed, to detect stale handles
+//
+// that is 25 bytes per session and no heap allocation per session. freed
+// slots are reused. a Session_arena is not thread-safe; give each thread its
+// own arena (or its own lock).
+class Session_arena
+{
+public:
+    // refers to one session. a handle stays valid until the session is
+    // destroyed; after that, using it throws instead of touching whichever
+    // session reuses the slot.
+    struct Handle
+    {
+        uint32_t slot;
+        uint32_t version;
+
+        // packs the handle into 64 bits (for sending over the wire)
+        uint64_t pack() const { return (uint64_t(version) << 32) | slot; }
+        static Handle unpack(uint64_t bits)
+        {
+            return {uint32_t(bits), uint32_t(bits >> 32)};
+        }
+    };
+
+    explicit Session_arena(Packed_board::Rules const& = Packed_board::Rules());
+
+    /// SESSIONS
+    // starts a new game seeded with seed, and returns its handle
+    Handle create(uint64_t seed);
+    // ends a session and frees its slot
+    void destroy(Handle);
+    // returns true if the handle refers to a live session
+    bool valid(Handle) const;
+    // restarts the game in an existing session (like Model::new_game)
+    void new_game(Handle);
+
+    /// GAMEPLAY
+    // plays one move, then spawns a block if anything moved (like
+    // Model::play_move). returns true if anything moved. does nothing once
+    // the game is over. throws std::invalid_argument for a stale handle.
+    bool play_move(Handle, Packed_board::Move);
+
+    /// GETTERS
+    // all of these throw std::invalid_argument for a stale handle
+    Packed_board get_board(Handle) const;
+    int get_val(Handle, Model::Position) const;
+    int get_score(Handle) const;
+    int get_game_over(Handle) const;
+
+    /// CAPACITY
+    // number of live sessions
+    size_t size() const { return live_; }
+    // number of slots, live or free
+    size_t capacity() const { return boards_.size(); }
+    // makes room for n sessions without reallocating
+    void reserve(size_t n);
+    // approximate bytes used by the pools
+    size_t memory_bytes() const;
+
+private:
+    Packed_board::Rules rules_;
+
+    /// POOLS (one entry per slot)
+    std::vector<uint64_t> boards_;
+    std::vector<uint32_t> scores_;
+    std::vector<uint8_t> status_;
+    std::vector<uint64_t> rngs_;
+    std::vector<uint32_t> versions_;
+    // also one bit per slot
+    std::vector<bool> live_slots_;
+
+    // slots of destroyed sessions, reused before growing the pools
+    std::vector<uint32_t> free_slots_;
+    size_t live_ = 0;
+
+    // returns the slot of a handle, or throws if it is stale
+    uint32_t check_(Handle) const;
+};
@@ -0,0 +1,266 @@
+#include "board.hxx"
+
+namespace {
+
+// number of possible 16-bit rows
+const int num_rows = 1 << 16;
+
+// lookup tables: for each possible row, the row after sliding it left or
+// right, and the points scored doing so.
+struct Row_tables
+{
+    uint16_t left[num_rows];
+    uint16_t right[num_rows];
+    uint32_t left_score[num_rows];
+    uint32_t right_score[num_rows];
+
+    Row_tables();
+};
+
+// reverses the order of the four nibbles in a row
+uint16_t
+reverse_row(uint16_t row)
+{
+    return uint16_t((row >> 12) | ((row >> 4) & 0x00F0)
+                    | ((row << 4) & 0x0F00) | (row << 12));
+}
+
+Row_tables::Row_tables()
+{
+    for (int row = 0; row < num_rows; row++) {
+        int line[4];
+        for (int i = 0; i < 4; i++) {
+            line[i] = (row >> (4 * i)) & 0xF;
+        }
+
+        // same order as Model::play_move: the block closest to the wall
+        // moves first, and a block made by merging can't merge again this
+        // move. 'last' is the index of the last filled cell; 'locked'
+        // says whether it was made by merging.
+        int out[4] = {0, 0, 0, 0};
+        int last = -1;
+        bool locked = false;
+        uint32_t points = 0;
+        for (int i = 0; i < 4; i++) {
+            int e = line[i];
+            if (e == 0) {
+                continue;
+            }
+            // exponent 15 is the largest a nibble can hold, so 15s don't merge
+            if (last >= 0 && not locked && out[last] == e && e < 15) {
+                out[last] = e + 1;
+                points += uint32_t(1) << (e + 1);
+                locked = true;
+            } else {
+                out[++last] = e;
+                locked = false;
+            }
+        }
+
+        uint16_t result = 0;
+        for (int i = 0; i < 4; i++) {
+            result |= uint16_t(out[i] << (4 * i));
+        }
+        left[row] = result;
+        left_score[row] = points;
+    }
+
+    for (int row = 0; row < num_rows; row++) {
+        uint16_t rev = reverse_row(uint16_t(row));
+        right[row] = reverse_row(left[rev]);
+        right_score[row] = left_score[rev];
+    }
+}
+
+Row_tables const&
+tables()
+{
+    // built once, on first use (thread-safe since C++11)
+    static Row_tables const t;
+    return t;
+}
+
+// applies a row table to all four rows of a board
+uint64_t
+slide_rows(uint64_t bits,
+           uint16_t const table[],
+           uint32_t const score[],
+           int& reward)
+{
+    uint64_t result = 0;
+    for (int r = 0; r < 4; r++) {
+        uint16_t row = uint16_t(bits >> (16 * r));
+        result |= uint64_t(table[row]) << (16 * r);
+        reward += int(score[row]);
+    }
+    return result;
+}
+
+}  // end anonymous namespace
+
+Model::Direction
+Packed_board::to_direction(Move move)
+{
+    switch (move) {
+    case left:
+        return {-1, 0};
+    case right:
+        return {1, 0};
+    case up:
+        return {0, -1};
+    case down:
+    default:
+        return {0, 1};
+    }
+}
+
+Packed_board
+Packed_board::from_model(Model const& model)
+{
+    Packed_board board;
+    for (int y = 0; y < model.get_size(); y++) {
+        for (int x = 0; x < model.get_size(); x++) {
+            int val = model.get_val({x, y});
+            int exp = 0;
+            while (val > 1) {
+                val >>= 1;
+                exp++;
+            }
+            board.set_exp({x, y}, exp);
+        }
+    }
+    return board;
+}
+
+int
+Packed_board::max_exp() const
+{
+    int best = 0;
+    for (int i = 0; i < 16; i++) {
+        int e = int((bits_ >> (4 * i)) & 0xF);
+        if (e > best) {
+            best = e;
+        }
+    }
+    return best;
+}
+
+int
+Packed_board::count_empty() const
+{
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        if (((bits_ >> (4 * i)) & 0xF) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint64_t
+Packed_board::transpose(uint64_t x)
+{
+    // swap nibbles across the diagonal, in 2x2 blocks then single cells
+    uint64_t a1 = x & 0xF0F00F0FF0F00F0Full;
+    uint64_t a2 = x & 0x0000F0F00000F0F0ull;
+    uint64_t a3 = x & 0x0F0F00000F0F0000ull;
+    uint64_t a = a1 | (a2 << 12) | (a3 >> 12);
+    uint64_t b1 = a & 0xFF00FF0000FF00FFull;
+    uint64_t b2 = a & 0x00FF00FF00000000ull;
+    uint64_t b3 = a & 0x00000000FF00FF00ull;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+Packed_board
+Packed_board::after_move(Move move, int& reward) const
+{
+    Row_tables const& t = tables();
+    switch (move) {
+    case left:
+        return Packed_board(slide_rows(bits_, t.left, t.left_score, reward));
+    case right:
+        return Packed_board(slide_rows(bits_, t.right, t.right_score,
+                                       reward));
+    case up:
+        return Packed_board(transpose(
+                slide_rows(transpose(bits_), t.left, t.left_score, reward)));
+    case down:
+    default:
+        return Packed_board(transpose(
+                slide_rows(transpose(bits_), t.right, t.right_score,
+                           reward)));
+    }
+}
+
+bool
+Packed_board::play_move(Move move, int& score)
+{
+    int reward = 0;
+    Packed_board next = after_move(move, reward);
+    if (next == *this) {
+        return false;
+    }
+    *this = next;
+    score += reward;
+    return true;
+}
+
+bool
+Packed_board::can_move(Move move) const
+{
+    int reward = 0;
+    return after_move(move, reward) != *this;
+}
+
+bool
+Packed_board::has_moves() const
+{
+    for (int m = 0; m < num_moves; m++) {
+        if (can_move(Move(m))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Packed_board::spawn(Rng& rng, Rules const& rules)
+{
+    int empties = count_empty();
+    if (empties == 0) {
+        return false;
+    }
+    // pick the n-th empty position, then the value (same odds as Model::spawn)
+    int n = rng.below(empties);
+    int exp = rng.below(100) < rules.four_percent ? 2 : 1;
+    for (int i = 0; i < 16; i++) {
+        if (((bits_ >> (4 * i)) & 0xF) == 0) {
+            if (n == 0) {
+                bits_ |= uint64_t(exp) << (4 * i);
+                return true;
+            }
+            n--;
+        }
+    }
+    return false;
+}
+
+void
+Packed_board::new_game(Rng& rng, Rules const& rules)
+{
+    bits_ = 0;
+    // the first block is always a 2, like Model::spawn_first
+    Rules first = rules;
+    first.four_percent = 0;
+    spawn(rng, first);
+    spawn(rng, rules);
+}
+
+int
+Packed_board::game_over(Rules const& rules) const
+{
+    if (rules.win_exponent > 0 && max_exp() >= rules.win_exponent) {
+        return 2;
+    }
+    return has_moves() ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "model.hxx"
+#include <cstdint>
+
+// rules that can be varied by the simulation tools. the defaults are
+// the rules used by Model.
+struct Board_rules
+{
+    // chance (in percent) that a spawned block is a 4 instead of a 2
+    int four_percent = 25;
+    // exponent of the winning block; the game ends when it appears.
+    // 0 means keep playing until no moves are possible.
+    int win_exponent = 11;
+};
+
+// a tiny deterministic random number generator (splitmix64) whose whole
+// state is one 64-bit word, so a game's spawn sequence can be replayed
+// from its seed.
+struct Board_rng
+{
+    uint64_t state;
+
+    explicit Board_rng(uint64_t seed = 0)
+            : state(seed)
+    { }
+
+    // returns the next 64 random bits
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // returns a number in [0, n)
+    int below(int n)
+    {
+        return int(((next() >> 32) * uint64_t(n)) >> 32);
+    }
+};
+
+// a Packed_board is a compact copy of a Model board used by the headless
+// tools (simulation, search). the whole 4x4 board fits in 64 bits: each
+// 4-bit nibble holds the exponent of a block (0 = empty, 1 = 2, 2 = 4, ...,
+// 11 = 2048). nibble i is the block at x = i % 4, y = i / 4.
+//
+// play_move follows exactly the same rules as Model::play_move, but moves
+// whole rows at a time through precomputed lookup tables, which makes it
+// thousands of times cheaper than copying a Model.
+class Packed_board
+{
+public:
+    /// MOVES
+    // moves are encoded in one byte so that they can be stored compactly.
+    // the order matches Model's four directions.
+    enum Move : uint8_t
+    {
+        left = 0,
+        right = 1,
+        up = 2,
+        down = 3,
+    };
+    static const int num_moves = 4;
+    // converts a Move to the Direction that Model::play_move takes
+    static Model::Direction to_direction(Move);
+
+    /// RULES AND RANDOMNESS
+    using Rules = Board_rules;
+    using Rng = Board_rng;
+
+    /// CONSTRUCTORS
+    // makes an empty board
+    Packed_board()
+            : bits_(0)
+    { }
+    // makes a board from its packed representation
+    explicit Packed_board(uint64_t bits)
+            : bits_(bits)
+    { }
+    // copies the current board of a Model
+    static Packed_board from_model(Model const&);
+
+    /// GETTERS
+    // gets the packed 64-bit representation
+    uint64_t bits() const { return bits_; }
+    // gets the exponent at a position (0 if empty)
+    int get_exp(Model::Position p) const
+    {
+        return int((bits_ >> (4 * (4 * p.y + p.x))) & 0xF);
+    }
+    // gets the value at a position, like Model::get_val
+    int get_val(Model::Position p) const
+    {
+        int e = get_exp(p);
+        return e == 0 ? 0 : 1 << e;
+    }
+    // gets the largest exponent on the board
+    int max_exp() const;
+    // gets the number of empty positions
+    int count_empty() const;
+    // gets the board with rows and columns swapped
+    Packed_board transposed() const
+    {
+        return Packed_board(transpose(bits_));
+    }
+
+    /// SETTERS
+    // puts a block with the given exponent at a position (0 clears it)
+    void set_exp(Model::Position p, int exp)
+    {
+        int shift = 4 * (4 * p.y + p.x);
+        bits_ = (bits_ & ~(uint64_t(0xF) << shift))
+                | (uint64_t(exp & 0xF) << shift);
+    }
+
+    /// GAMEPLAY
+    // plays one move. returns true if any block moved; adds the points
+    // scored by merging to score. does not spawn a new block.
+    bool play_move(Move, int& score);
+    // returns the board after a move without changing this one.
+    // reward receives the points scored.
+    Packed_board after_move(Move, int& reward) const;
+    // returns true if the move would change the board
+    bool can_move(Move) const;
+    // returns true if any move is possible
+    bool has_moves() const;
+    // spawns a block in a random empty position, with the 2/4 chances in
+    // rules. returns false (and does nothing) if the board is full.
+    bool spawn(Rng&, Rules const& = Rules());
+    // clears the board and spawns the two starting blocks like
+    // Model::new_game (the first one is always a 2).
+    void new_game(Rng&, Rules const& = Rules());
+    // returns 0 if moves are possible, 1 if lost, 2 if won (same meaning as
+    // Model::get_game_over)
+    int game_over(Rules const& = Rules()) const;
+
+    /// COMPARISON
+    bool operator==(Packed_board that) const { return bits_ == that.bits_; }
+    bool operator!=(Packed_board that) const { return bits_ != that.bits_; }
+
+private:
+    /// PRIVATE MEMBER VARIABLES
+    uint64_t bits_;
+
+    /// HELPERS
+    // swaps rows and columns, so that up/down can reuse the left/right tables
+    static uint64_t transpose(uint64_t);
+};
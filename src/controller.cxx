@@ -3,17 +3,64 @@
 
 Controller::Controller(int run_mode)
         : model_(run_mode),
-          view_(model_)
-{ }
+          view_(model_, animation_)
+{
+    // in the background, just keep the animation going slowly, and stop
+    // altogether when minimized
+    unfocused_frame_rate = 5;
+    hidden_frame_rate = 0;
+
+    // upload every texture up front, a few milliseconds' worth per frame
+    for (ge211::Sprite const* sprite : view_.textured_sprites()) {
+        warm_up(*sprite);
+    }
+    warm_up_budget = ge211::Duration(0.004);
+}
 
 void Controller::on_frame(double dt) {
-    model_.on_frame(dt);
+    GE211_TRACE_SCOPE("controller", "on_frame");
+
+    if (move_queue_.empty()) {
+        animation_.advance(dt);
+        return;
+    }
+
+    // a move keyed in while the last one is still animating shouldn't have
+    // to wait for it: skip to the end of that animation, and play the move
+    // in the same frame. one move per frame, so each one gets seen.
+    Model::Position dir = move_queue_.front();
+    move_queue_.pop_front();
+    animation_.finish();
+    if (model_.get_game_over() == 0) {
+        model_.play_move(dir);
+        animation_.start_move(model_);
+    }
+    if (model_.get_game_over() != 0) {
+        move_queue_.clear();
+    }
 }
 
 void
 Controller::draw(ge211::Sprite_set& set)
 {
     view_.draw(set);
+
+    if (not view_.overlay_shown()) {
+        return;
+    }
+    if (view_.overlay_needs_stats()) {
+        ge211::Frame_timing const& timing = frame_timing();
+        View::Overlay_stats stats;
+        stats.fps = get_frame_rate();
+        stats.load_percent = get_load_percent();
+        stats.work_p50 = timing.work_percentile(50);
+        stats.work_p95 = timing.work_percentile(95);
+        stats.work_p99 = timing.work_percentile(99);
+        stats.frames_over_budget = timing.over_budget_count();
+        stats.textures = ge211::texture_usage();
+        view_.update_overlay(stats);
+    }
+    view_.draw_overlay(set);
 }
 
 View::Dimensions
@@ -31,22 +78,43 @@ Controller::initial_window_title() const
 void
 Controller::on_key(ge211::Key key)
 {
-    // if the game is NOT over, play moves
-    if (model_.get_game_over() == 0) {
-        if (key == ge211::Key::left()) {
-            model_.play_move({-1, 0});
-        }
-        else if (key == ge211::Key::right()) {
-            model_.play_move({1, 0});
-        }
-        else if (key == ge211::Key::up()) {
-            model_.play_move({0, -1});
-        }
-        else if (key == ge211::Key::down()) {
-            model_.play_move({0, 1});
-        }
+    GE211_TRACE_SCOPE("controller", "on_key");
+
+    // 't' saves the trace recorded so far, when tracing is on (run with
+    // GE211_TRACE=file.json)
+    ge211::Tracer& tracer = ge211::Tracer::instance();
+    if (key == ge211::Key::code('t') && tracer.is_recording()) {
+        tracer.write();
+        return;
+    }
+    if (key == ge211::Key::code('p')) {
+        view_.toggle_overlay();
+        return;
+    }
+
+    // if the game is NOT over, queue moves for on_frame to play
+    if (model_.get_game_over() != 0) {
+        return;
+    }
+    Model::Position dir {0, 0};
+    if (key == ge211::Key::left()) {
+        dir = {-1, 0};
+    }
+    else if (key == ge211::Key::right()) {
+        dir = {1, 0};
+    }
+    else if (key == ge211::Key::up()) {
+        dir = {0, -1};
+    }
+    else if (key == ge211::Key::down()) {
+        dir = {0, 1};
+    }
+    else {
+        return;
+    }
+    if (move_queue_limit == 0 || move_queue_.size() < move_queue_limit) {
+        move_queue_.push_back(dir);
     }
-    // if the game is over, do nothing
 }
 
 void
@@ -55,6 +123,15 @@ Controller::on_mouse_down(ge211::Mouse_button, ge211::Posn<int> pos)
     if (pos.x > view_.get_ngb_pos()[0].x && pos.x < view_.get_ngb_pos()[1].x) {
         if (pos.y > view_.get_ngb_pos()[0].y && pos.y < view_.get_ngb_pos()[1].y) {
             model_.new_game();
+            animation_.finish();
+            move_queue_.clear();
         }
     }
-}
\ No newline at end of file
+}
+
+bool
+Controller::is_idle() const
+{
+    return not view_.overlay_shown() && move_queue_.empty()
+           && not animation_.is_animating();
+}
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "animation.hxx"
 #include "model.hxx"
 #include "view.hxx"
 #include <ge211.hxx>
+#include <deque>
 
 class Controller : public ge211::Abstract_game
 {
@@ -12,8 +14,14 @@ public:
     Controller(int);
 
     /// ANIMATION
+    // plays the next queued move, if any, or else keeps animating
     void on_frame(double dt) override;
 
+    /// INPUT QUEUE
+    // the most moves that can wait to be played; moves keyed in while the
+    // queue is full are dropped. 0 means no limit.
+    size_t move_queue_limit = 4;
+
 protected:
     /// DELEGATE TO VIEW
     void draw(ge211::Sprite_set& set) override;
@@ -21,13 +29,25 @@ protected:
     std::string initial_window_title() const override;
 
     /// INTERACTIONS
-    // move blocks using the arrow keys
+    // queue moves using the arrow keys; 'p' shows or hides the performance
+    // overlay; 't' writes the trace, if tracing
     void on_key(ge211::Key) override;
     // restart the game by clicking new game button
     void on_mouse_down(ge211::Mouse_button, ge211::Posn<int>) override;
 
+    /// IDLING
+    // the game is idle whenever nothing is animating or queued: nothing changes
+    // until the next key press or click, so the engine can wait for one
+    // instead of drawing the same frame over and over. it is never idle
+    // while the overlay is shown, so the overlay keeps updating and its
+    // numbers measure drawing, not waiting.
+    bool is_idle() const override;
+
 private:
     /// PRIVATE MEMBER VARIABLES
     Model model_;
+    Animation animation_;
     View view_;
+    // moves keyed in but not played yet, oldest first
+    std::deque<Model::Position> move_queue_;
 };
@@ -1,5 +1,7 @@
 #include <iostream>
+#include <string>
 #include "controller.hxx"
+#include "protocol.hxx"
 
 int
 main(int argc, char *argv[])
@@ -7,6 +9,25 @@ main(int argc, char *argv[])
     std::string command;
     int run_mode; // 0 = normal, 1 = lose, 2 = win
 
+    // bot protocol mode: no window, commands on stdin (see protocol.hxx)
+    if (argc >= 2 && std::string(argv[1]) == "--protocol") {
+        uint64_t seed = 2048;
+        if (argc == 3) {
+            try {
+                seed = std::stoull(argv[2]);
+            } catch (std::exception const&) {
+                std::cerr << "Usage: " << argv[0] << " --protocol [seed]\n";
+                return 1;
+            }
+        } else if (argc > 3) {
+            std::cerr << "Usage: " << argv[0] << " --protocol [seed]\n";
+            return 1;
+        }
+        std::ios::sync_with_stdio(false);
+        Bot_protocol(seed).run(std::cin, std::cout);
+        return 0;
+    }
+
     switch(argc) {
         case 1:
             run_mode = 0;
@@ -19,11 +40,13 @@ main(int argc, char *argv[])
                 run_mode = 1;
             } else {
                 std::cerr << "Usage: " << argv[0] << " [win/lose]\n";
+                std::cerr << "       " << argv[0] << " --protocol [seed]\n";
                 return 1;
             }
             break;
         default:
             std::cerr << "Usage: " << argv[0] << " [win/lose]\n";
+            std::cerr << "       " << argv[0] << " --protocol [seed]\n";
             return 1;
     }
 
@@ -30,6 +30,7 @@ Model::new_game() {
     score = 0;
     spawn_first();
     spawn();
+    version++;
 }
 
 void
@@ -103,10 +104,18 @@ Model::get_game_over() const
     return game_over_status;
 }
 
+unsigned long
+Model::get_version() const
+{
+    return version;
+}
+
 
 void
 Model::play_move(Direction dir)
 {
+    GE211_TRACE_SCOPE("model", "play_move");
+
     // before playing a move, we clear the moving_blocks and new_merged vector arrays
     // because new_merged stores all the new merges within a single move
     // and moving_blocks also stores all the blocks that move within a single move.
@@ -175,13 +184,14 @@ Model::play_move(Direction dir)
             }
         }
     }
-    // if something moved, spawn a new block and record direction
+    // if something moved, spawn a new block
     if (moved) {
         spawn();
-        direction = dir;
     }
     // update game_over_status
     game_over_status = is_game_over();
+    // moving_blocks was cleared even if nothing moved
+    version++;
 }
 
 bool
@@ -221,10 +231,7 @@ Model::move_block(Position start, Direction dir)
 
     if (moved) {
         // curr now holds the final destination
-        moving_blocks.push_back(moving_block(start.into<float>(),
-                                            curr.into<float>(),
-                                            val,
-                                            end_val));
+        moving_blocks.push_back(moving_block(start, curr, val, end_val));
     }
 
     return moved;
@@ -304,38 +311,6 @@ Model::merge_exists(Position pos) const
     return false;
 }
 
-void Model::on_frame(double dt) {
-    // set velocity according to direction of move
-    if (abs(direction.x) == 1) {
-        velocity = {float(direction.x) * speed, 0};
-    } else if (abs(direction.y) == 1) {
-        velocity = {0, float(direction.y) * speed};
-    }
-
-    // if a block is moving, update its position
-    // if it's at or past the end position, update is_moving to false
-    for (int i = 0; i < int(moving_blocks.size()); i++) {
-        moving_blocks[i].increment_curr(dt * velocity);
-        if (direction.x == 1) {
-            if (moving_blocks[i].get_curr().x >= moving_blocks[i].get_end().x) {
-                moving_blocks[i].set_is_moving(false);
-            }
-        } else if (direction.x == -1) {
-            if (moving_blocks[i].get_curr().x <= moving_blocks[i].get_end().x) {
-                moving_blocks[i].set_is_moving(false);
-            }
-        } else if (direction.y == 1) {
-            if (moving_blocks[i].get_curr().y >= moving_blocks[i].get_end().y) {
-                moving_blocks[i].set_is_moving(false);
-            }
-        } else if (direction.y == -1) {
-            if (moving_blocks[i].get_curr().y <= moving_blocks[i].get_end().y) {
-                moving_blocks[i].set_is_moving(false);
-            }
-        }
-    }
-}
-
 void
 Model::test_win_game() {
     game_over_status = 0;
@@ -353,6 +328,7 @@ Model::test_win_game() {
     board[3][2] = 16;
     score = 0;
     spawn();
+    version++;
 }
 
 void
@@ -382,4 +358,5 @@ Model::test_lose_game() {
     board[3][3] = 64;
     score = 0;
     spawn();
-}
\ No newline at end of file
+    version++;
+}
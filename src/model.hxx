@@ -29,6 +29,10 @@ public:
     int get_score() const;
     // gets the status of the game (returns game_over_status, 0 if moves are possible, 1 if lost, 2 if won)
     int get_game_over() const;
+    // gets a counter that goes up whenever anything the getters return
+    // changes. if it is the same as last time, the board is exactly the
+    // same as last time. (the animation has a version of its own.)
+    unsigned long get_version() const;
 
     /// GAMEPLAY CONTROLS
     // plays one move equivalent to pressing an arrow key
@@ -60,6 +64,8 @@ private:
     // keeps track of the value of the score, the sum total of the values of all
     // blocks created by merging.
     int score;
+    // the value returned by get_version()
+    unsigned long version = 0;
 
     /// BLOCK SPAWNING
     // spawns the first block of value 2 in a random position on the board.
@@ -93,61 +99,40 @@ private:
     // left, or right of block at Position.
     bool merge_exists(Position) const;
 
-    /// ANIMATION (PRIVATE)
-    // stores the direction of the last successful move
-    Position direction {0, 0};
-    // the speed at which blocks move
-    float speed = 20;
-    // stores the velocity of the blocks (on_frame sets velocity based on direction)
-    ge211::Dims<float> velocity {0, 0};
-    // a moving_block is a block that is moving this turn
+    /// MOVE RECORD (PRIVATE)
+    // the model only records which blocks moved where; animating them is
+    // up to the Animation (see animation.hxx).
+    // a moving_block is a block that moved this turn
     struct moving_block
     {
     private:
         // private member variables
-        bool is_moving = true; // is the block still moving or has it reached its end position?
-        ge211::Posn<float> start; // starting board position of block
-        ge211::Posn<float> end; // ending board position of block
-        ge211::Posn<float> curr; // current board position of block
+        Position start; // starting board position of block
+        Position end; // ending board position of block
         int value; // value of the block; 2, 4, 8, 16, 32, etc...
         int end_val; // value of the previous block at end position (before this block moved there)
     public:
         // constructor
-        moving_block(ge211::Posn<float> start,ge211::Posn<float> end, int val, int end_val)
+        moving_block(Position start, Position end, int val, int end_val)
                 : start(start),
                   end(end),
-                  curr(start),
                   value(val),
                   end_val(end_val)
         {}
 
         // getters
-        bool get_is_moving() const {
-            return is_moving;
-        }
-        ge211::Posn<float> get_start() const {
+        Position get_start() const {
             return start;
         }
-        ge211::Posn<float> get_end() const {
+        Position get_end() const {
             return end;
         }
-        ge211::Posn<float> get_curr() const {
-            return curr;
-        }
         int get_val() const {
             return value;
         }
         int get_end_val() const {
             return end_val;
         }
-
-        // setters/updaters
-        void increment_curr(ge211::Dims<float> inc) {
-            curr += inc;
-        }
-        void set_is_moving(bool b) {
-            is_moving = b;
-        }
     };
     // stores all the moving blocks for one turn
     std::vector<moving_block> moving_blocks;
@@ -155,11 +140,9 @@ private:
     Position new_spawn_pos {size + 10, size + 10};
 
 public:
-    /// ANIMATION (PUBLIC)
-    // update each moving_block's current position based on dt and velocity
-    void on_frame(double dt);
-    // get the moving_blocks vector
-    std::vector<moving_block> get_moving_blocks() const {
+    /// MOVE RECORD (PUBLIC)
+    // get the blocks that moved in the last move; empty if it moved nothing
+    std::vector<moving_block> const& get_moving_blocks() const {
         return moving_blocks;
     }
     // get the position of the newly spawned block this move
@@ -0,0 +1,389 @@
+#include "policy.hxx"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using Move = Packed_board::Move;
+
+namespace {
+
+// chance nodes less likely than this are scored by the heuristic instead of
+// being searched further
+const double min_probability = 0.0001;
+
+// score of a board with no moves left: the game is lost, which is worse than
+// anything the heuristic gives a board that can still move (its rows can
+// score below 0, but not by anywhere near this much)
+const double lost_value = -1e12;
+
+// heuristic value of every possible 16-bit row, built once on first use
+struct Row_heuristic
+{
+    float value[1 << 16];
+
+    Row_heuristic();
+};
+
+Row_heuristic::Row_heuristic()
+{
+    for (int row = 0; row < (1 << 16); row++) {
+        int line[4];
+        for (int i = 0; i < 4; i++) {
+            line[i] = (row >> (4 * i)) & 0xF;
+        }
+
+        double sum = 0;
+        int empty = 0;
+        int merges = 0;
+        int prev = 0;
+        int counter = 0;
+        for (int i = 0; i < 4; i++) {
+            int e = line[i];
+            sum += std::pow(e, 3.5);
+            if (e == 0) {
+                empty++;
+            } else {
+                if (prev == e) {
+                    counter++;
+                } else if (counter > 0) {
+                    merges += 1 + counter;
+                    counter = 0;
+                }
+                prev = e;
+            }
+        }
+        if (counter > 0) {
+            merges += 1 + counter;
+        }
+
+        // penalty for rows that go up and then down (or the reverse)
+        double mono_left = 0;
+        double mono_right = 0;
+        for (int i = 1; i < 4; i++) {
+            if (line[i - 1] > line[i]) {
+                mono_left += std::pow(line[i - 1], 4) - std::pow(line[i], 4);
+            } else {
+                mono_right += std::pow(line[i], 4) - std::pow(line[i - 1], 4);
+            }
+        }
+
+        value[row] = float(200000.0 + 270.0 * empty + 700.0 * merges
+                           - 47.0 * std::min(mono_left, mono_right)
+                           - 11.0 * sum);
+    }
+}
+
+Row_heuristic const&
+row_heuristic()
+{
+    static Row_heuristic const h;
+    return h;
+}
+
+double
+sum_rows(uint64_t bits, float const table[])
+{
+    return table[bits & 0xFFFF] + table[(bits >> 16) & 0xFFFF]
+           + table[(bits >> 32) & 0xFFFF] + table[(bits >> 48) & 0xFFFF];
+}
+
+}  // end anonymous namespace
+
+///
+/// RANDOM
+///
+
+std::string
+Random_policy::name() const
+{
+    return "random";
+}
+
+Move
+Random_policy::choose(Packed_board board, Packed_board::Rng& rng)
+{
+    Move possible[Packed_board::num_moves];
+    int count = 0;
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        if (board.can_move(Move(m))) {
+            possible[count++] = Move(m);
+        }
+    }
+    return count == 0 ? Packed_board::left : possible[rng.below(count)];
+}
+
+std::unique_ptr<Policy>
+Random_policy::clone() const
+{
+    return std::unique_ptr<Policy>(new Random_policy);
+}
+
+///
+/// GREEDY
+///
+
+std::string
+Greedy_policy::name() const
+{
+    return "greedy";
+}
+
+Move
+Greedy_policy::choose(Packed_board board, Packed_board::Rng&)
+{
+    Move best = Packed_board::left;
+    int best_reward = -1;
+    int best_empty = -1;
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board next = board.after_move(Move(m), reward);
+        if (next == board) {
+            continue;
+        }
+        int empty = next.count_empty();
+        if (reward > best_reward
+            || (reward == best_reward && empty > best_empty)) {
+            best = Move(m);
+            best_reward = reward;
+            best_empty = empty;
+        }
+    }
+    return best;
+}
+
+std::unique_ptr<Policy>
+Greedy_policy::clone() const
+{
+    return std::unique_ptr<Policy>(new Greedy_policy);
+}
+
+///
+/// EXPECTIMAX
+///
+
+Expectimax_policy::Expectimax_policy(int depth,
+                                     Packed_board::Rules const& rules)
+        : depth_(depth < 1 ? 1 : depth),
+          rules_(rules)
+{ }
+
+std::string
+Expectimax_policy::name() const
+{
+    return "search:" + std::to_string(depth_);
+}
+
+std::unique_ptr<Policy>
+Expectimax_policy::clone() const
+{
+    return std::unique_ptr<Policy>(new Expectimax_policy(depth_, rules_));
+}
+
+double
+Expectimax_policy::evaluate(Packed_board board)
+{
+    float const* table = row_heuristic().value;
+    return sum_rows(board.bits(), table)
+           + sum_rows(board.transposed().bits(), table);
+}
+
+Move
+Expectimax_policy::choose(Packed_board board, Packed_board::Rng&)
+{
+    Move best = Packed_board::left;
+    double best_value = 0;
+    bool found = false;
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board next = board.after_move(Move(m), reward);
+        if (next == board) {
+            continue;
+        }
+        nodes_++;
+        double value = chance_node(next, depth_ - 1, 1.0);
+        if (not found || value > best_value) {
+            best = Move(m);
+            best_value = value;
+            found = true;
+        }
+    }
+    return best;
+}
+
+double
+Expectimax_policy::chance_node(Packed_board board, int depth, double probability)
+{
+    int empty = board.count_empty();
+    if (depth <= 0 || probability < min_probability || empty == 0) {
+        return evaluate(board);
+    }
+
+    double four = rules_.four_percent / 100.0;
+    double total = 0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            if (board.get_exp({x, y}) != 0) {
+                continue;
+            }
+            Packed_board with_two = board;
+            with_two.set_exp({x, y}, 1);
+            total += (1 - four) * move_node(with_two, depth,
+                                            probability * (1 - four) / empty);
+            if (four > 0) {
+                Packed_board with_four = board;
+                with_four.set_exp({x, y}, 2);
+                total += four * move_node(with_four, depth,
+                                          probability * four / empty);
+            }
+        }
+    }
+    return total / empty;
+}
+
+double
+Expectimax_policy::move_node(Packed_board board, int depth, double probability)
+{
+    double best = lost_value;
+    bool found = false;
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board next = board.after_move(Move(m), reward);
+        if (next == board) {
+            continue;
+        }
+        nodes_++;
+        double value = chance_node(next, depth - 1, probability);
+        if (not found || value > best) {
+            best = value;
+            found = true;
+        }
+    }
+    return best;
+}
+
+///
+/// LEARNED (N-TUPLE)
+///
+
+Tuple_policy::Tuple_policy(std::string const& weights_path)
+        : path_(weights_path)
+{
+    std::ifstream in(weights_path, std::ios::binary);
+    if (not in) {
+        throw std::runtime_error("could not open weights " + weights_path);
+    }
+
+    std::vector<unsigned char> bytes(4 << 16);
+    in.read(reinterpret_cast<char*>(bytes.data()),
+            std::streamsize(bytes.size()));
+    if (in.gcount() != std::streamsize(bytes.size()) || in.peek() != EOF) {
+        throw std::runtime_error(weights_path
+                                 + ": expected 65536 32-bit floats");
+    }
+
+    std::vector<float> weights(1 << 16);
+    for (size_t i = 0; i < weights.size(); i++) {
+        uint32_t word = uint32_t(bytes[4 * i])
+                        | (uint32_t(bytes[4 * i + 1]) << 8)
+                        | (uint32_t(bytes[4 * i + 2]) << 16)
+                        | (uint32_t(bytes[4 * i + 3]) << 24);
+        float value;
+        static_assert(sizeof value == sizeof word, "float must be 32 bits");
+        std::memcpy(&value, &word, sizeof value);
+        weights[i] = value;
+    }
+    weights_ = std::make_shared<std::vector<float> const>(std::move(weights));
+}
+
+std::string
+Tuple_policy::name() const
+{
+    return "learned:" + path_;
+}
+
+std::unique_ptr<Policy>
+Tuple_policy::clone() const
+{
+    // shares the (read-only) weights
+    return std::unique_ptr<Policy>(new Tuple_policy(*this));
+}
+
+double
+Tuple_policy::evaluate(Packed_board board) const
+{
+    float const* table = weights_->data();
+    return sum_rows(board.bits(), table)
+           + sum_rows(board.transposed().bits(), table);
+}
+
+Move
+Tuple_policy::choose(Packed_board board, Packed_board::Rng&)
+{
+    Move best = Packed_board::left;
+    double best_value = 0;
+    bool found = false;
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board next = board.after_move(Move(m), reward);
+        if (next == board) {
+            continue;
+        }
+        nodes_++;
+        double value = reward + evaluate(next);
+        if (not found || value > best_value) {
+            best = Move(m);
+            best_value = value;
+            found = true;
+        }
+    }
+    return best;
+}
+
+std::unique_ptr<Policy>
+make_policy(std::string const& name,
+            int depth,
+            Packed_board::Rules const& rules)
+{
+    if (name == "random") {
+        return std::unique_ptr<Policy>(new Random_policy);
+    } else if (name == "greedy") {
+        return std::unique_ptr<Policy>(new Greedy_policy);
+    } else if (name == "search") {
+        return std::unique_ptr<Policy>(new Expectimax_policy(depth, rules));
+    } else {
+        return nullptr;
+    }
+}
+
+std::unique_ptr<Policy>
+policy_from_spec(std::string const& spec, Packed_board::Rules const& rules)
+{
+    size_t colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+    std::string param = colon == std::string::npos ? ""
+                                                   : spec.substr(colon + 1);
+
+    if (name == "learned") {
+        if (param.empty()) {
+            return nullptr;
+        }
+        return std::unique_ptr<Policy>(new Tuple_policy(param));
+    }
+    if (name == "search") {
+        int depth = 2;
+        if (not param.empty()) {
+            try {
+                depth = std::stoi(param);
+            } catch (std::exception const&) {
+                return nullptr;
+            }
+        }
+        return make_policy(name, depth, rules);
+    }
+    if (not param.empty()) {
+        return nullptr;
+    }
+    return make_policy(name, 2, rules);
+}
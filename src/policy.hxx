@@ -0,0 +1,120 @@
+#pragma once
+
+#include "board.hxx"
+#include <memory>
+#include <string>
+#include <vector>
+
+// a Policy picks moves for the headless tools (simulation, tournaments).
+// each thread owns its own Policy, so policies may keep scratch state
+// without locking.
+class Policy
+{
+public:
+    virtual ~Policy() = default;
+
+    // the name used on the command line and in reports
+    virtual std::string name() const = 0;
+
+    // picks a move that changes the board. the board must have at least
+    // one possible move. rng belongs to the game (but is separate from the
+    // spawns), so randomized policies stay reproducible from the game seed.
+    virtual Packed_board::Move choose(Packed_board, Packed_board::Rng& rng) = 0;
+
+    // makes a fresh copy for another thread (sharing any read-only data)
+    virtual std::unique_ptr<Policy> clone() const = 0;
+
+    // number of board positions examined so far (0 for policies that
+    // don't search)
+    long long nodes() const { return nodes_; }
+
+protected:
+    long long nodes_ = 0;
+};
+
+// picks a uniformly random possible move
+class Random_policy : public Policy
+{
+public:
+    std::string name() const override;
+    Packed_board::Move choose(Packed_board, Packed_board::Rng&) override;
+    std::unique_ptr<Policy> clone() const override;
+};
+
+// picks the move that scores the most points right now; ties go to the
+// move that leaves the most empty positions
+class Greedy_policy : public Policy
+{
+public:
+    std::string name() const override;
+    Packed_board::Move choose(Packed_board, Packed_board::Rng&) override;
+    std::unique_ptr<Policy> clone() const override;
+};
+
+// looks depth moves ahead (counting its own move), averaging over every
+// possible spawn (expectimax), and scores the leaves with a hand-tuned
+// heuristic
+class Expectimax_policy : public Policy
+{
+public:
+    explicit Expectimax_policy(int depth,
+                               Packed_board::Rules const& = Packed_board::Rules());
+
+    std::string name() const override;
+    Packed_board::Move choose(Packed_board, Packed_board::Rng&) override;
+    std::unique_ptr<Policy> clone() const override;
+
+    // heuristic value of a board: rewards empty positions, possible merges
+    // and rows/columns that are monotonic (sorted)
+    static double evaluate(Packed_board);
+
+private:
+    int depth_;
+    Packed_board::Rules rules_;
+
+    // value of a board right after a move, before the spawn
+    double chance_node(Packed_board, int depth, double probability);
+    // value of a board right after a spawn, when it's the player's turn
+    double move_node(Packed_board, int depth, double probability);
+};
+
+// a learned evaluator: an n-tuple network over the four rows and four
+// columns, all sharing one table of 65536 weights (one per possible line).
+// it plays the move whose reward plus after-move value is highest.
+//
+// the weights file is 65536 little-endian 32-bit floats, indexed by the
+// 16-bit line (nibble 0 = the cell nearest the left or top wall).
+class Tuple_policy : public Policy
+{
+public:
+    // loads the weights. throws std::runtime_error if the file is missing
+    // or the wrong size.
+    explicit Tuple_policy(std::string const& weights_path);
+
+    std::string name() const override;
+    Packed_board::Move choose(Packed_board, Packed_board::Rng&) override;
+    std::unique_ptr<Policy> clone() const override;
+
+    // value of a board according to the weights
+    double evaluate(Packed_board) const;
+
+private:
+    std::string path_;
+    std::shared_ptr<std::vector<float> const> weights_;
+};
+
+// makes a policy from its command-line name ("random", "greedy" or
+// "search"). depth is only used by "search". returns nullptr if the name
+// is not recognized.
+std::unique_ptr<Policy>
+make_policy(std::string const& name,
+            int depth = 2,
+            Packed_board::Rules const& = Packed_board::Rules());
+
+// makes a policy from a spec that may carry its parameter after a colon:
+// "random", "greedy", "search:3" or "learned:weights.bin". returns nullptr
+// if the spec is not recognized; throws std::runtime_error if a weights
+// file can't be loaded.
+std::unique_ptr<Policy>
+policy_from_spec(std::string const& spec,
+                 Packed_board::Rules const& = Packed_board::Rules());
@@ -0,0 +1,170 @@
+#include "protocol.hxx"
+#include <cctype>
+
+namespace {
+
+// output buffer size; flushed early if it fills up
+const size_t buffer_size = 1 << 16;
+
+}  // end anonymous namespace
+
+Bot_protocol::Bot_protocol(uint64_t seed)
+        : rng_(seed)
+{
+    out_.reserve(buffer_size);
+    board_.new_game(rng_);
+}
+
+void
+Bot_protocol::run(std::istream& in, std::ostream& out)
+{
+    std::string line;
+    while (std::getline(in, line)) {
+        bool keep_going = handle_line(line);
+        // only write when the reader would otherwise block (or the buffer
+        // is full), never once per line
+        if (not keep_going || out_.size() >= buffer_size - 256
+            || in.rdbuf()->in_avail() <= 0)
+        {
+            flush(out);
+        }
+        if (not keep_going) {
+            return;
+        }
+    }
+    flush(out);
+}
+
+void
+Bot_protocol::flush(std::ostream& out)
+{
+    if (not out_.empty()) {
+        out.write(out_.data(), std::streamsize(out_.size()));
+        out_.clear();
+    }
+    out.flush();
+}
+
+bool
+Bot_protocol::handle_line(std::string const& line)
+{
+    // split off the first word
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos) {
+        return true;
+    }
+    size_t end = line.find_first_of(" \t\r", start);
+    std::string word = line.substr(start, end == std::string::npos
+                                          ? std::string::npos
+                                          : end - start);
+
+    if (word == "quit") {
+        return false;
+    }
+    if (word == "state") {
+        print_state_(0);
+        return true;
+    }
+    if (word == "new") {
+        uint64_t seed = rng_.next();
+        if (end != std::string::npos) {
+            size_t arg = line.find_first_not_of(" \t\r", end);
+            if (arg != std::string::npos) {
+                try {
+                    seed = std::stoull(line.substr(arg));
+                } catch (std::exception const&) {
+                    out_ += "error bad seed\n";
+                    return true;
+                }
+            }
+        }
+        new_game_(seed);
+        print_state_(0);
+        return true;
+    }
+
+    // otherwise the line is a batch of moves; check it all before playing
+    std::vector<Packed_board::Move> moves;
+    for (char c : line) {
+        switch (std::toupper((unsigned char) c)) {
+        case 'L':
+            moves.push_back(Packed_board::left);
+            break;
+        case 'R':
+            moves.push_back(Packed_board::right);
+            break;
+        case 'U':
+            moves.push_back(Packed_board::up);
+            break;
+        case 'D':
+            moves.push_back(Packed_board::down);
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+            break;
+        default:
+            out_ += "error unknown command\n";
+            return true;
+        }
+    }
+
+    int moved = 0;
+    for (Packed_board::Move move : moves) {
+        if (board_.game_over() != 0) {
+            break;
+        }
+        if (board_.play_move(move, score_)) {
+            board_.spawn(rng_);
+            moved++;
+        }
+    }
+    print_state_(moved);
+    return true;
+}
+
+void
+Bot_protocol::new_game_(uint64_t seed)
+{
+    rng_ = Packed_board::Rng(seed);
+    board_.new_game(rng_);
+    score_ = 0;
+}
+
+void
+Bot_protocol::print_state_(int moved)
+{
+    print_int_(moved);
+    out_ += ' ';
+    print_int_(score_);
+    out_ += ' ';
+    print_int_(board_.game_over());
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            out_ += ' ';
+            print_int_(board_.get_val({x, y}));
+        }
+    }
+    out_ += '\n';
+}
+
+void
+Bot_protocol::print_int_(long long value)
+{
+    // formats into the buffer directly, without a stream
+    char digits[24];
+    int n = 0;
+    bool negative = value < 0;
+    unsigned long long v = negative ? 0ull - (unsigned long long) value
+                                    : (unsigned long long) value;
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    if (negative) {
+        out_ += '-';
+    }
+    while (n > 0) {
+        out_ += digits[--n];
+    }
+}
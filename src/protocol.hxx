@@ -0,0 +1,55 @@
+#pragma once
+
+#include "board.hxx"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// line-oriented bot protocol for `game --protocol`: no window, commands on
+// stdin, board states on stdout.
+//
+// COMMANDS (one per line)
+//   a batch of moves, e.g. "LLURD" or "l l u": L/R/U/D (any case, spaces
+//   ignored). all moves are played, then one state line is printed.
+//   "new" or "new SEED"   starts a new game and prints its state
+//   "state"               prints the current state
+//   "quit"                exits
+//
+// STATE LINE
+//   "<moved> <score> <game_over> <16 block values, row by row>"
+//   where moved is how many moves of the batch changed the board and
+//   game_over means the same as Model::get_game_over (0, 1 lost, 2 won).
+//   moves sent after the game is over are ignored.
+//   unknown commands print "error <message>".
+//
+// output is built in a preallocated buffer and only flushed when there is
+// no more input waiting, so a harness that pipes many lines at once gets
+// one write for all of them.
+class Bot_protocol
+{
+public:
+    explicit Bot_protocol(uint64_t seed);
+
+    // reads commands until "quit" or end of input
+    void run(std::istream&, std::ostream&);
+
+    // handles one line, appending any output to the buffer. returns false
+    // for "quit".
+    bool handle_line(std::string const&);
+
+    // the buffered output, and a way to send it
+    std::string const& pending_output() const { return out_; }
+    void flush(std::ostream&);
+
+private:
+    Packed_board::Rng rng_;
+    Packed_board board_;
+    int score_ = 0;
+    std::string out_;
+
+    void new_game_(uint64_t seed);
+    void print_state_(int moved);
+    void print_int_(long long);
+};
@@ -0,0 +1,497 @@
+#include "server.hxx"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace server_protocol;
+
+///
+/// PROTOCOL
+///
+
+namespace {
+
+void
+put_u32(uint8_t* p, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = uint8_t(value >> (8 * i));
+    }
+}
+
+void
+put_u64(uint8_t* p, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = uint8_t(value >> (8 * i));
+    }
+}
+
+uint32_t
+get_u32(uint8_t const* p)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint64_t
+get_u64(uint8_t const* p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+}  // end anonymous namespace
+
+namespace server_protocol {
+
+void
+encode(Request const& request, uint8_t out[request_size])
+{
+    out[0] = request.op;
+    out[1] = request.move;
+    put_u64(out + 2, request.arg);
+}
+
+Request
+decode_request(uint8_t const in[request_size])
+{
+    return {in[0], in[1], get_u64(in + 2)};
+}
+
+void
+encode(Response const& response, uint8_t out[response_size])
+{
+    out[0] = response.status;
+    out[1] = response.moved;
+    out[2] = response.game_over;
+    out[3] = 0;
+    put_u32(out + 4, response.score);
+    put_u64(out + 8, response.board);
+    put_u64(out + 16, response.session);
+}
+
+Response
+decode_response(uint8_t const in[response_size])
+{
+    Response response;
+    response.status = in[0];
+    response.moved = in[1];
+    response.game_over = in[2];
+    response.score = get_u32(in + 4);
+    response.board = get_u64(in + 8);
+    response.session = get_u64(in + 16);
+    return response;
+}
+
+}  // end namespace server_protocol
+
+///
+/// SERVER
+///
+
+namespace {
+
+// most shards the session id format can name
+const size_t max_shards = 256;
+// most events handled per epoll_wait
+const int max_events = 64;
+// stop reading from a client whose unsent responses pass this size, until
+// it catches up
+const size_t max_pending_output = 1 << 20;
+// when out of descriptors, a reactor stops accepting for this long (or
+// until it drops a connection) instead of spinning on the listen socket
+const int accept_pause_ms = 100;
+
+// one client connection, owned by one reactor thread
+struct Connection
+{
+    int fd;
+    // bytes of an incomplete request
+    std::vector<uint8_t> input;
+    // responses not yet written, starting at output_pos
+    std::vector<uint8_t> output;
+    size_t output_pos = 0;
+    bool want_write = false;
+};
+
+// epoll tags for the two descriptors that are not connections
+char listen_tag;
+char stop_tag;
+
+void
+set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+void
+update_events(int epoll_fd, Connection& conn)
+{
+    bool pending = conn.output_pos < conn.output.size();
+    epoll_event event {};
+    event.events = 0;
+    if (conn.output.size() - conn.output_pos < max_pending_output) {
+        event.events |= EPOLLIN;
+    }
+    if (pending) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = &conn;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+    conn.want_write = pending;
+}
+
+// writes as much pending output as the socket takes. returns false if the
+// connection failed.
+bool
+flush_output(Connection& conn)
+{
+    while (conn.output_pos < conn.output.size()) {
+        ssize_t n = send(conn.fd,
+                         conn.output.data() + conn.output_pos,
+                         conn.output.size() - conn.output_pos,
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn.output_pos += size_t(n);
+    }
+    conn.output.clear();
+    conn.output_pos = 0;
+    return true;
+}
+
+}  // end anonymous namespace
+
+Game_server::Game_server(std::string const& socket_path,
+                         int threads,
+                         uint64_t seed)
+        : path_(socket_path),
+          next_seed_(seed)
+{
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (size_t(threads) > max_shards) {
+        threads = int(max_shards);
+    }
+    for (int t = 0; t < threads; t++) {
+        shards_.emplace_back(new Shard);
+    }
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof address.sun_path) {
+        throw std::runtime_error("socket path is too long: " + socket_path);
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("socket: " + std::string(strerror(errno)));
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd_, (sockaddr*) &address, sizeof address) < 0
+        || listen(listen_fd_, SOMAXCONN) < 0)
+    {
+        std::string error = strerror(errno);
+        close(listen_fd_);
+        throw std::runtime_error("could not listen on " + socket_path + ": "
+                                 + error);
+    }
+    set_nonblocking(listen_fd_);
+
+    stop_fd_ = eventfd(0, EFD_NONBLOCK);
+    if (stop_fd_ < 0) {
+        std::string error = strerror(errno);
+        close(listen_fd_);
+        unlink(socket_path.c_str());
+        throw std::runtime_error("eventfd: " + error);
+    }
+}
+
+Game_server::~Game_server()
+{
+    close(listen_fd_);
+    close(stop_fd_);
+    unlink(path_.c_str());
+}
+
+void
+Game_server::run()
+{
+    std::vector<std::thread> reactors;
+    for (size_t s = 1; s < shards_.size(); s++) {
+        reactors.emplace_back(&Game_server::reactor_, this, s);
+    }
+    reactor_(0);
+    for (std::thread& reactor : reactors) {
+        reactor.join();
+    }
+}
+
+void
+Game_server::stop()
+{
+    // only async-signal-safe calls here
+    uint64_t one = 1;
+    ssize_t ignored = write(stop_fd_, &one, sizeof one);
+    (void) ignored;
+}
+
+size_t
+Game_server::sessions()
+{
+    size_t total = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->arena.size();
+    }
+    return total;
+}
+
+uint64_t
+Game_server::session_id_(size_t shard, Session_arena::Handle handle)
+{
+    Session_arena::Handle tagged {
+            handle.slot | uint32_t(shard << shard_shift),
+            handle.version};
+    return tagged.pack();
+}
+
+Game_server::Shard*
+Game_server::find_shard_(uint64_t id, Session_arena::Handle& handle)
+{
+    handle = Session_arena::Handle::unpack(id);
+    size_t shard = handle.slot >> shard_shift;
+    handle.slot &= (uint32_t(1) << shard_shift) - 1;
+    return shard < shards_.size() ? shards_[shard].get() : nullptr;
+}
+
+Response
+Game_server::handle(Request const& request, size_t home_shard)
+{
+    Response response;
+
+    if (request.op == new_game) {
+        Shard& shard = *shards_[home_shard % shards_.size()];
+        uint64_t seed = request.arg;
+        if (seed == 0) {
+            seed = Packed_board::Rng(next_seed_++).next();
+        }
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.arena.size() >= (size_t(1) << shard_shift)) {
+            response.status = bad_request;
+            return response;
+        }
+        Session_arena::Handle handle = shard.arena.create(seed);
+        response.session = session_id_(home_shard % shards_.size(), handle);
+        response.board = shard.arena.get_board(handle).bits();
+        response.game_over = uint8_t(shard.arena.get_game_over(handle));
+        return response;
+    }
+
+    if (request.op != move && request.op != get_state
+        && request.op != end_game)
+    {
+        response.status = bad_request;
+        return response;
+    }
+    if (request.op == move && request.move >= Packed_board::num_moves) {
+        response.status = bad_request;
+        return response;
+    }
+
+    Session_arena::Handle handle;
+    Shard* shard = find_shard_(request.arg, handle);
+    response.session = request.arg;
+    if (not shard) {
+        response.status = unknown_session;
+        return response;
+    }
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    Session_arena& arena = shard->arena;
+    if (not arena.valid(handle)) {
+        response.status = unknown_session;
+        return response;
+    }
+
+    if (request.op == move) {
+        response.moved = arena.play_move(handle,
+                                         Packed_board::Move(request.move));
+    }
+    response.board = arena.get_board(handle).bits();
+    response.score = uint32_t(arena.get_score(handle));
+    response.game_over = uint8_t(arena.get_game_over(handle));
+    if (request.op == end_game) {
+        arena.destroy(handle);
+    }
+    return response;
+}
+
+void
+Game_server::reactor_(size_t shard)
+{
+    int epoll_fd = epoll_create1(0);
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+
+    // the listen socket is level-triggered, so while accepting fails for
+    // lack of descriptors it stays readable; it comes out of the epoll set
+    // until there may be a descriptor to spare again
+    bool accepting = false;
+    auto start_accepting = [&] {
+        epoll_event event {};
+        // EPOLLEXCLUSIVE: only one reactor wakes up per new connection
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.ptr = &listen_tag;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd_, &event);
+        accepting = true;
+    };
+    auto pause_accepting = [&] {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, listen_fd_, nullptr);
+        accepting = false;
+    };
+
+    start_accepting();
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = &stop_tag;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd_, &event);
+
+    auto drop = [&](Connection& conn) {
+        // conn is destroyed by the erase, so don't use it after
+        int fd = conn.fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+    };
+
+    uint8_t buffer[1 << 16];
+    epoll_event events[max_events];
+    bool running = true;
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, max_events,
+                           accepting ? -1 : accept_pause_ms);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        // a pause ends after accept_pause_ms, or sooner if the reactor has
+        // other work (which may have dropped a connection); if there is
+        // still no descriptor to spare, that costs one failed accept
+        if (not accepting) {
+            start_accepting();
+        }
+
+        for (int i = 0; i < n; i++) {
+            void* tag = events[i].data.ptr;
+
+            if (tag == &stop_tag) {
+                // level-triggered and never read, so every reactor sees it
+                running = false;
+                continue;
+            }
+
+            if (tag == &listen_tag) {
+                for (;;) {
+                    int fd = accept4(listen_fd_, nullptr, nullptr,
+                                     SOCK_NONBLOCK);
+                    if (fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED) {
+                            continue;
+                        }
+                        if (errno == EMFILE || errno == ENFILE
+                            || errno == ENOBUFS || errno == ENOMEM)
+                        {
+                            pause_accepting();
+                        }
+                        break;
+                    }
+                    std::unique_ptr<Connection> conn(new Connection);
+                    conn->fd = fd;
+                    epoll_event conn_event {};
+                    conn_event.events = EPOLLIN;
+                    conn_event.data.ptr = conn.get();
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &conn_event);
+                    connections[fd] = std::move(conn);
+                }
+                continue;
+            }
+
+            Connection& conn = *static_cast<Connection*>(tag);
+            bool alive = true;
+
+            if (events[i].events & EPOLLIN) {
+                for (;;) {
+                    ssize_t got = read(conn.fd, buffer, sizeof buffer);
+                    if (got > 0) {
+                        conn.input.insert(conn.input.end(),
+                                          buffer, buffer + got);
+                        continue;
+                    }
+                    if (got < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        alive = false;
+                    }
+                    break;
+                }
+
+                // answer every complete request; responses are batched
+                // into one write
+                size_t used = 0;
+                while (conn.input.size() - used >= request_size) {
+                    Request request = decode_request(conn.input.data() + used);
+                    used += request_size;
+                    uint8_t out[response_size];
+                    encode(handle(request, shard), out);
+                    conn.output.insert(conn.output.end(),
+                                       out, out + response_size);
+                }
+                conn.input.erase(conn.input.begin(),
+                                 conn.input.begin() + std::ptrdiff_t(used));
+            } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                alive = false;
+            }
+
+            // send what we have even if the client hung up after sending
+            if (not flush_output(conn)) {
+                alive = false;
+            }
+            if (not alive) {
+                drop(conn);
+                continue;
+            }
+            bool pending = conn.output_pos < conn.output.size();
+            if (pending != conn.want_write
+                || conn.output.size() - conn.output_pos >= max_pending_output)
+            {
+                update_events(epoll_fd, conn);
+            }
+        }
+    }
+
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    close(epoll_fd);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "arena.hxx"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// headless game server: hosts many games over a Unix domain socket, with no
+// window. games are stored in Session_arenas, which play by the same rules
+// as Model (see board_test).
+//
+// PROTOCOL (all integers little-endian, fixed-size frames)
+//
+//   request, 10 bytes:  u8 op, u8 move, u64 arg
+//     op 1  new game    arg = seed (0: server picks one)
+//     op 2  move        arg = session, move = Packed_board::Move (0-3)
+//     op 3  get state   arg = session
+//     op 4  end game    arg = session
+//
+//   response, 24 bytes: u8 status, u8 moved, u8 game_over, u8 unused,
+//                       u32 score, u64 board, u64 session
+//     status 0 = ok, 1 = unknown session, 2 = bad request
+//
+// a client may send many requests without waiting; responses come back in
+// order. Linux only (epoll).
+namespace server_protocol {
+
+const size_t request_size = 10;
+const size_t response_size = 24;
+
+enum Op : uint8_t
+{
+    new_game = 1,
+    move = 2,
+    get_state = 3,
+    end_game = 4,
+};
+
+enum Status : uint8_t
+{
+    ok = 0,
+    unknown_session = 1,
+    bad_request = 2,
+};
+
+struct Request
+{
+    uint8_t op;
+    uint8_t move;
+    uint64_t arg;
+};
+
+struct Response
+{
+    uint8_t status = ok;
+    uint8_t moved = 0;
+    uint8_t game_over = 0;
+    uint32_t score = 0;
+    uint64_t board = 0;
+    uint64_t session = 0;
+};
+
+void encode(Request const&, uint8_t out[request_size]);
+Request decode_request(uint8_t const in[request_size]);
+void encode(Response const&, uint8_t out[response_size]);
+Response decode_response(uint8_t const in[response_size]);
+
+}  // end namespace server_protocol
+
+class Game_server
+{
+public:
+    // binds and listens on the socket path (removing a stale socket file
+    // first). throws std::runtime_error on failure.
+    Game_server(std::string const& socket_path, int threads, uint64_t seed);
+    // stops the server and removes the socket file
+    ~Game_server();
+
+    Game_server(Game_server const&) = delete;
+    Game_server& operator=(Game_server const&) = delete;
+
+    // runs the reactor threads until stop() is called
+    void run();
+    // makes run() return soon. safe to call from a signal handler.
+    void stop();
+
+    // handles one request. new games go to the home shard (each reactor
+    // thread has its own). used by the reactors; public for testing.
+    server_protocol::Response handle(server_protocol::Request const&,
+                                     size_t home_shard = 0);
+
+    // number of live sessions across all shards
+    size_t sessions();
+
+private:
+    // sessions are split into one shard per reactor thread. a connection
+    // usually only touches its own reactor's shard, so the lock is
+    // uncontended; it is only there for clients that move between
+    // connections.
+    struct Shard
+    {
+        std::mutex mutex;
+        Session_arena arena;
+    };
+
+    std::string path_;
+    int listen_fd_ = -1;
+    int stop_fd_ = -1;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> next_seed_;
+
+    // a session id is a packed Session_arena::Handle with the shard number
+    // in the top 8 bits of the slot, so each shard holds up to 2^24
+    // sessions
+    static const int shard_shift = 24;
+    static uint64_t session_id_(size_t shard, Session_arena::Handle);
+    // finds the shard of a session id and fills in its handle; returns
+    // null if there is no such shard
+    Shard* find_shard_(uint64_t id, Session_arena::Handle&);
+
+    // body of one reactor thread
+    void reactor_(size_t shard);
+};
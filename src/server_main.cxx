@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "server.hxx"
+
+// headless game server. serves games over a Unix domain socket using the
+// binary protocol described in server.hxx; no window is opened.
+
+namespace {
+
+// reactor threads by default. a few are enough to keep up with many
+// connections, and leave the other cores free (so sessions per core
+// measures the server, not how many cores it took)
+const int default_threads = 4;
+
+Game_server* running_server = nullptr;
+
+void
+on_signal(int)
+{
+    if (running_server) {
+        running_server->stop();
+    }
+}
+
+void
+usage(char const* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --socket PATH  socket to listen on (default 2048.sock)\n"
+              << "  --threads T    reactor threads (default: "
+              << default_threads << ", or fewer if there are fewer cores)\n"
+              << "  --seed S       seed for games started without one\n";
+}
+
+}  // end anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    std::string path = "2048.sock";
+    // hardware_concurrency() is 0 if it can't tell
+    int cores = int(std::thread::hardware_concurrency());
+    int threads = cores > 0 ? std::min(default_threads, cores)
+                            : default_threads;
+    uint64_t seed = 2048;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (flag == "--socket") {
+                path = value;
+            } else if (flag == "--threads") {
+                threads = std::stoi(value);
+            } else if (flag == "--seed") {
+                seed = std::stoull(value);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+
+        Game_server server(path, threads, seed);
+        running_server = &server;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+
+        std::cerr << argv[0] << ": listening on " << path << "\n";
+        server.run();
+        running_server = nullptr;
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "simulation.hxx"
+
+// headless self-play runner. plays many games with one policy on all cores
+// and prints statistics about them; no window is opened.
+
+namespace {
+
+void
+usage(char const* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --games N      number of games to play (default 1000)\n"
+              << "  --policy P     random, greedy or search (default random)\n"
+              << "  --depth D      search depth for the search policy (default 2)\n"
+              << "  --threads T    worker threads (default: one per core)\n"
+              << "  --seed S       base seed for the spawns (default 2048)\n"
+              << "  --four P       chance in percent of spawning a 4 (default 25)\n"
+              << "  --win-tile V   block that wins the game, 0 to play until\n"
+              << "                 stuck (default 2048)\n"
+              << "  --trajectories F  also stream every (board, move, reward,\n"
+              << "                 next board) to the binary file F\n";
+}
+
+// converts a block value like 2048 to its exponent; 0 stays 0
+int
+value_to_exp(long long value)
+{
+    int exp = 0;
+    while (value > 1) {
+        value >>= 1;
+        exp++;
+    }
+    return exp;
+}
+
+}  // end anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    Sim_options options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string flag = argv[i];
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (flag == "--games") {
+                options.games = std::stoll(value);
+            } else if (flag == "--policy") {
+                options.policy = value;
+            } else if (flag == "--depth") {
+                options.depth = std::stoi(value);
+            } else if (flag == "--threads") {
+                options.threads = std::stoi(value);
+            } else if (flag == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (flag == "--four") {
+                options.rules.four_percent = std::stoi(value);
+            } else if (flag == "--trajectories") {
+                options.trajectory_path = value;
+            } else if (flag == "--win-tile") {
+                options.rules.win_exponent = value_to_exp(std::stoll(value));
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+
+        Sim_result result = run_simulation(options);
+        print_report(std::cout, options, result);
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,332 @@
+#include "simulation.hxx"
+#include "trajectory.hxx"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// games are handed out to the worker threads in batches of this size, so
+// that the shared counter is touched rarely
+const long long batch_size = 256;
+
+// forwards moves to a thread's trajectory sink
+class Trajectory_observer : public Game_observer
+{
+public:
+    explicit Trajectory_observer(Trajectory_writer& writer)
+            : sink_(writer)
+    { }
+
+    void on_move(Packed_board before,
+                 Packed_board::Move move,
+                 int reward,
+                 Packed_board after,
+                 bool game_over) override
+    {
+        sink_.add(before, move, reward, after, game_over);
+    }
+
+private:
+    Trajectory_writer::Sink sink_;
+};
+
+// plays games until the shared counter runs out, counting them in stats.
+// stats is only touched by this thread. writer may be null.
+void
+worker(Sim_options const& options,
+       std::atomic<long long>& next_game,
+       Trajectory_writer* writer,
+       Sim_stats& stats)
+{
+    std::unique_ptr<Policy> policy = make_policy(options.policy,
+                                                 options.depth,
+                                                 options.rules);
+    std::unique_ptr<Trajectory_observer> observer;
+    if (writer) {
+        observer.reset(new Trajectory_observer(*writer));
+    }
+    // counted locally and copied out once, so that threads never write to
+    // neighbouring memory while playing
+    Sim_stats local;
+
+    for (;;) {
+        long long first = next_game.fetch_add(batch_size,
+                                              std::memory_order_relaxed);
+        if (first >= options.games) {
+            break;
+        }
+        long long last = std::min(first + batch_size, options.games);
+        for (long long i = first; i < last; i++) {
+            Packed_board::Rng rng(game_seed(options.seed, i));
+            long long score = 0;
+            long long moves = 0;
+            Packed_board end = play_game(*policy, rng, options.rules,
+                                         score, moves, observer.get());
+            local.add_game(end.max_exp(), score, moves,
+                           end.game_over(options.rules) == 2);
+        }
+    }
+
+    stats = local;
+}
+
+}  // end anonymous namespace
+
+///
+/// STATISTICS
+///
+
+void
+Sim_stats::add_game(int max_exp, long long game_score, long long game_moves,
+                    bool won)
+{
+    games++;
+    moves += game_moves;
+    if (won) {
+        wins++;
+    }
+
+    max_tile[std::min(std::max(max_exp, 0), exps - 1)]++;
+
+    long long bucket = std::min(game_score / score_bucket_width,
+                                (long long) score_buckets - 1);
+    score[bucket]++;
+    score_sum += game_score;
+    score_square_sum += double(game_score) * double(game_score);
+    if (score_min < 0 || game_score < score_min) {
+        score_min = game_score;
+    }
+    score_max = std::max(score_max, game_score);
+
+    if (length_min < 0 || game_moves < length_min) {
+        length_min = game_moves;
+    }
+    length_max = std::max(length_max, game_moves);
+}
+
+void
+Sim_stats::merge(Sim_stats const& that)
+{
+    if (that.games == 0) {
+        return;
+    }
+
+    games += that.games;
+    moves += that.moves;
+    wins += that.wins;
+    for (int e = 0; e < exps; e++) {
+        max_tile[e] += that.max_tile[e];
+    }
+    for (int b = 0; b < score_buckets; b++) {
+        score[b] += that.score[b];
+    }
+    score_sum += that.score_sum;
+    score_square_sum += that.score_square_sum;
+    if (score_min < 0 || that.score_min < score_min) {
+        score_min = that.score_min;
+    }
+    score_max = std::max(score_max, that.score_max);
+    if (length_min < 0 || that.length_min < length_min) {
+        length_min = that.length_min;
+    }
+    length_max = std::max(length_max, that.length_max);
+}
+
+double
+Sim_stats::score_mean() const
+{
+    return games == 0 ? 0 : double(score_sum) / double(games);
+}
+
+double
+Sim_stats::score_stddev() const
+{
+    if (games == 0) {
+        return 0;
+    }
+    double mean = score_mean();
+    double variance = score_square_sum / double(games) - mean * mean;
+    return variance > 0 ? std::sqrt(variance) : 0;
+}
+
+long long
+Sim_stats::score_percentile(double fraction) const
+{
+    long long target = (long long) std::ceil(fraction * double(games));
+    long long seen = 0;
+    for (int b = 0; b < score_buckets; b++) {
+        seen += score[b];
+        if (seen >= target && seen > 0) {
+            // report the top of the bucket, clamped to the real maximum
+            return std::min((long long) (b + 1) * score_bucket_width,
+                            score_max);
+        }
+    }
+    return score_max;
+}
+
+double
+Sim_result::moves_per_second() const
+{
+    return seconds > 0 ? double(stats.moves) / seconds : 0;
+}
+
+double
+Sim_result::games_per_second() const
+{
+    return seconds > 0 ? double(stats.games) / seconds : 0;
+}
+
+///
+/// RUNNING
+///
+
+uint64_t
+game_seed(uint64_t base, long long index)
+{
+    Packed_board::Rng mixer(base ^ (uint64_t(index) * 0xD1B54A32D192ED03ull));
+    return mixer.next();
+}
+
+Packed_board
+play_game(Policy& policy,
+          Packed_board::Rng& rng,
+          Packed_board::Rules const& rules,
+          long long& score,
+          long long& moves,
+          Game_observer* observer)
+{
+    // the policy gets its own generator, so the spawns only depend on the
+    // seed and not on how many random numbers the policy used. every
+    // policy then sees the same spawn sequence for the same seed.
+    Packed_board::Rng policy_rng(rng.next());
+    Packed_board board;
+    board.new_game(rng, rules);
+    int points = 0;
+    while (board.game_over(rules) == 0) {
+        Packed_board::Move move = policy.choose(board, policy_rng);
+        Packed_board before = board;
+        int reward = 0;
+        if (not board.play_move(move, reward)) {
+            // a policy must pick a possible move; stop rather than loop
+            break;
+        }
+        board.spawn(rng, rules);
+        points += reward;
+        moves++;
+        if (observer) {
+            observer->on_move(before, move, reward, board,
+                              board.game_over(rules) != 0);
+        }
+    }
+    score += points;
+    return board;
+}
+
+Sim_result
+run_simulation(Sim_options const& options)
+{
+    if (not make_policy(options.policy, options.depth, options.rules)) {
+        throw std::invalid_argument("unknown policy: " + options.policy);
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    std::unique_ptr<Trajectory_writer> writer;
+    if (not options.trajectory_path.empty()) {
+        writer.reset(new Trajectory_writer(options.trajectory_path));
+    }
+
+    std::atomic<long long> next_game {0};
+    std::vector<Sim_stats> per_thread(threads);
+    std::vector<std::thread> pool;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back(worker,
+                          std::cref(options),
+                          std::ref(next_game),
+                          writer.get(),
+                          std::ref(per_thread[t]));
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (writer) {
+        writer->finish();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    Sim_result result;
+    for (Sim_stats const& stats : per_thread) {
+        result.stats.merge(stats);
+    }
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.threads = threads;
+    if (writer) {
+        result.trajectory_rows = writer->rows_written();
+    }
+    return result;
+}
+
+void
+print_report(std::ostream& out,
+             Sim_options const& options,
+             Sim_result const& result)
+{
+    Sim_stats const& stats = result.stats;
+
+    out << "policy:        " << options.policy;
+    if (options.policy == "search") {
+        out << " (depth " << options.depth << ")";
+    }
+    out << "\n";
+    out << "games:         " << stats.games << " on " << result.threads
+        << " threads in " << std::fixed << std::setprecision(2)
+        << result.seconds << " s\n";
+    out << "throughput:    " << std::setprecision(0)
+        << result.games_per_second() << " games/s, "
+        << result.moves_per_second() << " moves/s\n";
+    if (not options.trajectory_path.empty()) {
+        out << "trajectories:  " << result.trajectory_rows << " moves written to "
+            << options.trajectory_path << "\n";
+    }
+    if (stats.games == 0) {
+        return;
+    }
+
+    out << "score:         mean " << std::setprecision(1)
+        << stats.score_mean() << ", stddev " << stats.score_stddev()
+        << ", min " << stats.score_min << ", max " << stats.score_max << "\n";
+    out << "score pctiles: p10 " << stats.score_percentile(0.10)
+        << ", p50 " << stats.score_percentile(0.50)
+        << ", p90 " << stats.score_percentile(0.90)
+        << ", p99 " << stats.score_percentile(0.99) << "\n";
+    out << "game length:   mean " << double(stats.moves) / double(stats.games)
+        << ", min " << stats.length_min << ", max " << stats.length_max
+        << " moves\n";
+    if (options.rules.win_exponent > 0) {
+        out << "wins:          " << stats.wins << " ("
+            << 100.0 * double(stats.wins) / double(stats.games) << "%)\n";
+    }
+
+    out << "max tile:\n";
+    for (int e = 1; e < Sim_stats::exps; e++) {
+        if (stats.max_tile[e] == 0) {
+            continue;
+        }
+        out << std::setw(8) << (1 << e) << "  " << std::setw(12)
+            << stats.max_tile[e] << "  " << std::setw(6) << std::setprecision(2)
+            << 100.0 * double(stats.max_tile[e]) / double(stats.games)
+            << "%\n";
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "board.hxx"
+#include "policy.hxx"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// headless self-play: plays many games with a Policy across all cores and
+// collects statistics about them.
+
+/// OPTIONS
+struct Sim_options
+{
+    // number of games to play
+    long long games = 1000;
+    // policy name, as accepted by make_policy
+    std::string policy = "random";
+    // search depth (only used by the "search" policy)
+    int depth = 2;
+    // number of worker threads; 0 means one per core
+    int threads = 0;
+    // base seed; game i always gets the same spawns for the same seed
+    uint64_t seed = 2048;
+    // rules variant to play
+    Packed_board::Rules rules;
+    // if not empty, every move is also streamed to this file (see
+    // trajectory.hxx)
+    std::string trajectory_path;
+};
+
+/// STATISTICS
+// counters for a set of finished games. each worker thread fills in its
+// own Sim_stats without any locking; they are merged once at the end.
+struct Sim_stats
+{
+    // scores are counted in buckets of this many points
+    static const int score_bucket_width = 256;
+    // number of score buckets; the last one also counts larger scores
+    static const int score_buckets = 2048;
+    // largest exponent a Packed_board can hold, plus one
+    static const int exps = 16;
+
+    long long games = 0;
+    long long moves = 0;
+    long long wins = 0;
+
+    // max_tile[e] is the number of games whose largest block was 2^e
+    long long max_tile[exps] = {};
+    // score[b] is the number of games that scored in bucket b
+    long long score[score_buckets] = {};
+    long long score_sum = 0;
+    double score_square_sum = 0;
+    long long score_min = -1;
+    long long score_max = 0;
+    // game lengths, in moves
+    long long length_min = -1;
+    long long length_max = 0;
+
+    // adds one finished game
+    void add_game(int max_exp, long long score, long long moves, bool won);
+    // adds all the games counted by another Sim_stats
+    void merge(Sim_stats const&);
+
+    // average and standard deviation of the score
+    double score_mean() const;
+    double score_stddev() const;
+    // approximate score below which the given fraction of games fall
+    // (resolution is score_bucket_width)
+    long long score_percentile(double fraction) const;
+};
+
+/// RESULT
+struct Sim_result
+{
+    Sim_stats stats;
+    // wall-clock time for the whole run
+    double seconds = 0;
+    // number of worker threads actually used
+    int threads = 0;
+    // number of moves written to options.trajectory_path
+    long long trajectory_rows = 0;
+
+    double moves_per_second() const;
+    double games_per_second() const;
+};
+
+/// RUNNING
+// the seed for game number index of a run with the given base seed
+uint64_t game_seed(uint64_t base, long long index);
+
+// receives every move of a game played by play_game
+class Game_observer
+{
+public:
+    virtual ~Game_observer() = default;
+
+    // before is the board the policy saw, after is the board after the
+    // move and the spawn; reward is the points the move scored
+    virtual void on_move(Packed_board before,
+                         Packed_board::Move,
+                         int reward,
+                         Packed_board after,
+                         bool game_over) = 0;
+};
+
+// plays one game to the end with the given policy. spawns are drawn from
+// rng; the policy gets a separate generator seeded from it. returns the
+// final board and adds the game's score and length to score and moves. if
+// observer is not null, it is told about every move.
+Packed_board play_game(Policy&,
+                       Packed_board::Rng&,
+                       Packed_board::Rules const&,
+                       long long& score,
+                       long long& moves,
+                       Game_observer* observer = nullptr);
+
+// plays options.games games across options.threads threads and returns the
+// merged statistics. throws std::invalid_argument if the policy name is
+// not recognized, and std::runtime_error if the trajectory file can't be
+// written.
+Sim_result run_simulation(Sim_options const&);
+
+// prints a human-readable report
+void print_report(std::ostream&, Sim_options const&, Sim_result const&);
@@ -0,0 +1,302 @@
+#include "tournament.hxx"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+namespace {
+
+// games per job. smaller than the simulation's batches, since a search
+// policy can take a long time over each game.
+const long long batch_size = 16;
+
+// two-sided 95% normal quantile
+const double z95 = 1.96;
+
+// CPU time used so far by the calling thread, in seconds. falls back to
+// wall-clock time where there is no per-thread clock.
+double
+thread_cpu_seconds()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0) {
+        return double(now.tv_sec) + double(now.tv_nsec) * 1e-9;
+    }
+#endif
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// what one thread counted for one entrant
+struct Entrant_tally
+{
+    Sim_stats stats;
+    double cpu_seconds = 0;
+};
+
+// plays jobs until the shared counter runs out. job j is batch j / n of
+// entrant j % n. tallies is only touched by this thread; scores are
+// written straight into results, since no two jobs share a game.
+void
+worker(Tournament_options const& options,
+       std::vector<std::unique_ptr<Policy>> const& prototypes,
+       std::atomic<long long>& next_job,
+       std::vector<Entrant_result>& results,
+       std::vector<Entrant_tally>& tallies)
+{
+    size_t entrants = prototypes.size();
+    long long batches = (options.games + batch_size - 1) / batch_size;
+    long long jobs = batches * (long long) entrants;
+
+    // each thread plays with its own copies, made when first needed
+    std::vector<std::unique_ptr<Policy>> policies(entrants);
+    std::vector<Entrant_tally> local(entrants);
+
+    for (;;) {
+        long long job = next_job.fetch_add(1, std::memory_order_relaxed);
+        if (job >= jobs) {
+            break;
+        }
+        size_t e = size_t(job % (long long) entrants);
+        long long first = job / (long long) entrants * batch_size;
+        long long last = std::min(first + batch_size, options.games);
+
+        if (not policies[e]) {
+            policies[e] = prototypes[e]->clone();
+        }
+
+        double start = thread_cpu_seconds();
+        for (long long i = first; i < last; i++) {
+            Packed_board::Rng rng(game_seed(options.seed, i));
+            long long score = 0;
+            long long moves = 0;
+            Packed_board end = play_game(*policies[e], rng, options.rules,
+                                         score, moves);
+            local[e].stats.add_game(end.max_exp(), score, moves,
+                                    end.game_over(options.rules) == 2);
+            results[e].scores[size_t(i)] = score;
+        }
+        local[e].cpu_seconds += thread_cpu_seconds() - start;
+    }
+
+    tallies = std::move(local);
+}
+
+// mean and 95% margin of a list of samples
+void
+mean_and_margin(std::vector<double> const& samples,
+                double& mean,
+                double& margin)
+{
+    mean = 0;
+    margin = 0;
+    if (samples.empty()) {
+        return;
+    }
+    double sum = 0;
+    for (double x : samples) {
+        sum += x;
+    }
+    mean = sum / double(samples.size());
+    if (samples.size() < 2) {
+        return;
+    }
+    double square_sum = 0;
+    for (double x : samples) {
+        square_sum += (x - mean) * (x - mean);
+    }
+    double variance = square_sum / double(samples.size() - 1);
+    margin = z95 * std::sqrt(variance / double(samples.size()));
+}
+
+}  // end anonymous namespace
+
+///
+/// RESULT
+///
+
+double
+Entrant_result::score_margin() const
+{
+    std::vector<double> samples(scores.begin(), scores.end());
+    double mean, margin;
+    mean_and_margin(samples, mean, margin);
+    return margin;
+}
+
+double
+Entrant_result::games_per_cpu_second() const
+{
+    return cpu_seconds > 0 ? double(stats.games) / cpu_seconds : 0;
+}
+
+double
+Entrant_result::moves_per_cpu_second() const
+{
+    return cpu_seconds > 0 ? double(stats.moves) / cpu_seconds : 0;
+}
+
+std::vector<size_t>
+Tournament_result::ranking() const
+{
+    std::vector<size_t> order(entrants.size());
+    for (size_t e = 0; e < order.size(); e++) {
+        order[e] = e;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entrants[a].stats.score_mean() > entrants[b].stats.score_mean();
+    });
+    return order;
+}
+
+void
+paired_difference(Entrant_result const& a,
+                  Entrant_result const& b,
+                  double& mean,
+                  double& margin)
+{
+    size_t n = std::min(a.scores.size(), b.scores.size());
+    std::vector<double> differences(n);
+    for (size_t i = 0; i < n; i++) {
+        differences[i] = double(a.scores[i] - b.scores[i]);
+    }
+    mean_and_margin(differences, mean, margin);
+}
+
+///
+/// RUNNING
+///
+
+Tournament_result
+run_tournament(Tournament_options const& options)
+{
+    if (options.entrants.empty()) {
+        throw std::invalid_argument("a tournament needs at least one entrant");
+    }
+
+    // made once here, so bad specs fail early and weights load only once
+    std::vector<std::unique_ptr<Policy>> prototypes;
+    for (std::string const& spec : options.entrants) {
+        std::unique_ptr<Policy> policy = policy_from_spec(spec, options.rules);
+        if (not policy) {
+            throw std::invalid_argument("unknown policy: " + spec);
+        }
+        prototypes.push_back(std::move(policy));
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+    Tournament_result result;
+    result.threads = threads;
+    result.entrants.resize(prototypes.size());
+    for (size_t e = 0; e < prototypes.size(); e++) {
+        result.entrants[e].spec = options.entrants[e];
+        result.entrants[e].scores.assign(size_t(std::max(options.games, 0LL)),
+                                         0);
+    }
+
+    std::atomic<long long> next_job {0};
+    std::vector<std::vector<Entrant_tally>> per_thread(threads);
+    std::vector<std::thread> pool;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back(worker,
+                          std::cref(options),
+                          std::cref(prototypes),
+                          std::ref(next_job),
+                          std::ref(result.entrants),
+                          std::ref(per_thread[t]));
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (std::vector<Entrant_tally> const& tallies : per_thread) {
+        for (size_t e = 0; e < tallies.size(); e++) {
+            result.entrants[e].stats.merge(tallies[e].stats);
+            result.entrants[e].cpu_seconds += tallies[e].cpu_seconds;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+void
+print_tournament(std::ostream& out,
+                 Tournament_options const& options,
+                 Tournament_result const& result)
+{
+    out << "tournament: " << result.entrants.size() << " entrants x "
+        << options.games << " games (same spawns) on " << result.threads
+        << " threads in " << std::fixed << std::setprecision(2)
+        << result.seconds << " s\n\n";
+
+    out << std::left << std::setw(5) << "rank"
+        << std::setw(20) << "policy"
+        << std::right << std::setw(18) << "score (95%)"
+        << std::setw(8) << "win%"
+        << std::setw(9) << "top tile"
+        << std::setw(20) << "vs leader"
+        << std::setw(12) << "games/cpu-s"
+        << std::setw(12) << "moves/cpu-s" << "\n";
+
+    std::vector<size_t> order = result.ranking();
+    for (size_t r = 0; r < order.size(); r++) {
+        Entrant_result const& entrant = result.entrants[order[r]];
+        Sim_stats const& stats = entrant.stats;
+
+        std::ostringstream score;
+        score << std::fixed << std::setprecision(0) << stats.score_mean()
+              << " +- " << entrant.score_margin();
+
+        // the most common largest block
+        int top = 0;
+        for (int e = 1; e < Sim_stats::exps; e++) {
+            if (stats.max_tile[e] > stats.max_tile[top]) {
+                top = e;
+            }
+        }
+
+        std::ostringstream versus;
+        if (r == 0) {
+            versus << "-";
+        } else {
+            double mean, margin;
+            paired_difference(result.entrants[order[0]], entrant,
+                              mean, margin);
+            versus << std::fixed << std::setprecision(0) << "-" << mean
+                   << " +- " << margin;
+        }
+
+        out << std::left << std::setw(5) << r + 1
+            << std::setw(20) << entrant.spec
+            << std::right << std::setw(18) << score.str()
+            << std::setw(8) << std::setprecision(1)
+            << (stats.games ? 100.0 * double(stats.wins) / double(stats.games)
+                            : 0.0)
+            << std::setw(9) << (top ? 1LL << top : 0)
+            << std::setw(20) << versus.str()
+            << std::setw(12) << std::setprecision(1)
+            << entrant.games_per_cpu_second()
+            << std::setw(12) << std::setprecision(0)
+            << entrant.moves_per_cpu_second() << "\n";
+    }
+
+    out << "\nvs leader: how many points behind the leader, compared game by "
+           "game\n";
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "board.hxx"
+#include "policy.hxx"
+#include "simulation.hxx"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// head-to-head tournament: several policies each play the same games. game
+// i has the same seed (and so the same spawns, see play_game) for every
+// entrant, so differences in score come from the policies and not from
+// luck, and can be compared game by game.
+
+/// OPTIONS
+struct Tournament_options
+{
+    // entrants, as accepted by policy_from_spec ("search:3", ...)
+    std::vector<std::string> entrants;
+    // number of games each entrant plays
+    long long games = 200;
+    // number of worker threads; 0 means one per core
+    int threads = 0;
+    // base seed, as for Sim_options
+    uint64_t seed = 2048;
+    // rules variant to play
+    Packed_board::Rules rules;
+};
+
+/// RESULT
+struct Entrant_result
+{
+    // the spec it was made from
+    std::string spec;
+    Sim_stats stats;
+    // scores[i] is the score of game i
+    std::vector<long long> scores;
+    // CPU time spent in this entrant's games, summed over threads. unlike
+    // wall-clock time, this isn't skewed by which entrants happened to
+    // share the machine with which.
+    double cpu_seconds = 0;
+
+    // half-width of the 95% confidence interval for the mean score
+    double score_margin() const;
+    double games_per_cpu_second() const;
+    double moves_per_cpu_second() const;
+};
+
+struct Tournament_result
+{
+    std::vector<Entrant_result> entrants;
+    // wall-clock time for the whole tournament
+    double seconds = 0;
+    // number of worker threads actually used
+    int threads = 0;
+
+    // entrant indices from best to worst mean score
+    std::vector<size_t> ranking() const;
+};
+
+/// RUNNING
+// plays every entrant's games across options.threads threads. games are
+// handed out as (entrant, batch) jobs interleaved across entrants, so a
+// slow entrant doesn't leave the other threads idle at the end. throws
+// std::invalid_argument if an entrant isn't recognized (or there are
+// none), and std::runtime_error if a weights file can't be loaded.
+Tournament_result run_tournament(Tournament_options const&);
+
+// mean and 95% margin of (a's score - b's score) over the shared games
+void paired_difference(Entrant_result const& a,
+                       Entrant_result const& b,
+                       double& mean,
+                       double& margin);
+
+// prints the ranked table
+void print_tournament(std::ostream&,
+                      Tournament_options const&,
+                      Tournament_result const&);
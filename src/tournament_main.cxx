@@ -0,0 +1,69 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "tournament.hxx"
+
+// tournament runner. several policies play the same seeded games on all
+// cores, and are ranked by score; no window is opened.
+
+namespace {
+
+void
+usage(char const* program)
+{
+    std::cerr << "Usage: " << program << " [options] POLICY...\n"
+              << "  POLICY is random, greedy, search:DEPTH or learned:WEIGHTS\n"
+              << "  (WEIGHTS: 65536 little-endian floats, one per row)\n"
+              << "  --games N      games per policy (default 200)\n"
+              << "  --threads T    worker threads (default: one per core)\n"
+              << "  --seed S       base seed for the spawns (default 2048)\n"
+              << "  --four P       chance in percent of spawning a 4 (default 25)\n";
+}
+
+}  // end anonymous namespace
+
+int
+main(int argc, char *argv[])
+{
+    Tournament_options options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string flag = argv[i];
+            if (flag.compare(0, 2, "--") != 0) {
+                options.entrants.push_back(flag);
+                continue;
+            }
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (flag == "--games") {
+                options.games = std::stoll(value);
+            } else if (flag == "--threads") {
+                options.threads = std::stoi(value);
+            } else if (flag == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (flag == "--four") {
+                options.rules.four_percent = std::stoi(value);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+
+        if (options.entrants.empty()) {
+            options.entrants = {"random", "greedy", "search:1", "search:2"};
+        }
+
+        Tournament_result result = run_tournament(options);
+        print_tournament(std::cout, options, result);
+    } catch (std::exception const& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
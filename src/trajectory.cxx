@@ -0,0 +1,372 @@
+#include "trajectory.hxx"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+char const header_magic[8] = {'2', '0', '4', '8', 'T', 'R', 'J', '1'};
+char const trailer_magic[8] = {'2', '0', '4', '8', 'I', 'D', 'X', '1'};
+
+// size of the trailer: chunk count, footer offset, magic
+const int trailer_size = 24;
+// size of one footer entry: offset, rows, reward bytes
+const int index_entry_size = 16;
+
+uint64_t
+decode_u64(uint8_t const* p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint32_t
+decode_u32(uint8_t const* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16)
+           | (uint32_t(p[3]) << 24);
+}
+
+}  // end anonymous namespace
+
+///
+/// CHUNKS
+///
+
+void
+Trajectory_chunk::clear()
+{
+    boards.clear();
+    moves.clear();
+    rewards.clear();
+    next_boards.clear();
+}
+
+void
+Trajectory_chunk::reserve(size_t rows)
+{
+    boards.reserve(rows);
+    moves.reserve(rows);
+    // most rewards fit in one or two bytes
+    rewards.reserve(2 * rows);
+    next_boards.reserve(rows);
+}
+
+void
+Trajectory_chunk::add(Packed_board before,
+                      Packed_board::Move move,
+                      int reward,
+                      Packed_board after,
+                      bool game_over)
+{
+    boards.push_back(before.bits());
+    moves.push_back(uint8_t(move | (game_over ? game_over_flag : 0)));
+    uint32_t value = uint32_t(reward);
+    while (value >= 0x80) {
+        rewards.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    rewards.push_back(uint8_t(value));
+    next_boards.push_back(after.bits());
+}
+
+std::vector<uint32_t>
+Trajectory_chunk::decode_rewards() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(rows());
+    uint32_t value = 0;
+    int shift = 0;
+    for (uint8_t byte : rewards) {
+        value |= uint32_t(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+        } else {
+            result.push_back(value);
+            value = 0;
+            shift = 0;
+        }
+    }
+    return result;
+}
+
+///
+/// WRITER
+///
+
+Trajectory_writer::Trajectory_writer(std::string const& path)
+        : out_(path, std::ios::binary | std::ios::trunc)
+{
+    if (not out_) {
+        throw std::runtime_error("could not open " + path + " for writing");
+    }
+    write_bytes_(header_magic, sizeof header_magic);
+    io_thread_ = std::thread(&Trajectory_writer::run_, this);
+}
+
+Trajectory_writer::~Trajectory_writer()
+{
+    try {
+        finish();
+    } catch (std::exception const&) {
+        // nowhere to report it from a destructor
+    }
+}
+
+void
+Trajectory_writer::finish()
+{
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_one();
+    io_thread_.join();
+
+    uint64_t footer_offset = offset_;
+    for (Index_entry const& entry : index_) {
+        write_u64_(entry.offset);
+        write_u32_(entry.rows);
+        write_u32_(entry.reward_bytes);
+    }
+    write_u64_(index_.size());
+    write_u64_(footer_offset);
+    write_bytes_(trailer_magic, sizeof trailer_magic);
+    out_.close();
+
+    if (out_.fail()) {
+        throw std::runtime_error("error writing trajectory file");
+    }
+}
+
+void
+Trajectory_writer::submit_(Trajectory_chunk& chunk)
+{
+    chunk.in_flight = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(&chunk);
+    }
+    queued_.notify_one();
+}
+
+void
+Trajectory_writer::wait_written_(Trajectory_chunk& chunk)
+{
+    if (not chunk.in_flight) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_.wait(lock, [&] { return not chunk.in_flight; });
+}
+
+void
+Trajectory_writer::run_()
+{
+    for (;;) {
+        Trajectory_chunk* chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queued_.wait(lock, [&] { return stopping_ || not queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            chunk = queue_.front();
+            queue_.pop_front();
+        }
+
+        write_chunk_(*chunk);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            chunk->in_flight = false;
+        }
+        written_.notify_all();
+    }
+}
+
+void
+Trajectory_writer::write_chunk_(Trajectory_chunk const& chunk)
+{
+    index_.push_back({offset_,
+                      uint32_t(chunk.rows()),
+                      uint32_t(chunk.rewards.size())});
+    write_u64s_(chunk.boards);
+    write_bytes_(chunk.moves.data(), chunk.moves.size());
+    write_bytes_(chunk.rewards.data(), chunk.rewards.size());
+    write_u64s_(chunk.next_boards);
+    rows_written_ += (long long) chunk.rows();
+}
+
+void
+Trajectory_writer::write_bytes_(void const* data, size_t size)
+{
+    out_.write(static_cast<char const*>(data), std::streamsize(size));
+    offset_ += size;
+}
+
+void
+Trajectory_writer::write_u32_(uint32_t value)
+{
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = uint8_t(value >> (8 * i));
+    }
+    write_bytes_(bytes, sizeof bytes);
+}
+
+void
+Trajectory_writer::write_u64_(uint64_t value)
+{
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = uint8_t(value >> (8 * i));
+    }
+    write_bytes_(bytes, sizeof bytes);
+}
+
+void
+Trajectory_writer::write_u64s_(std::vector<uint64_t> const& values)
+{
+    std::vector<uint8_t> bytes(8 * values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        for (int b = 0; b < 8; b++) {
+            bytes[8 * i + b] = uint8_t(values[i] >> (8 * b));
+        }
+    }
+    write_bytes_(bytes.data(), bytes.size());
+}
+
+///
+/// SINK
+///
+
+Trajectory_writer::Sink::Sink(Trajectory_writer& writer)
+        : writer_(writer)
+{
+    chunks_[0].reserve(chunk_rows);
+    chunks_[1].reserve(chunk_rows);
+}
+
+Trajectory_writer::Sink::~Sink()
+{
+    flush();
+}
+
+void
+Trajectory_writer::Sink::add(Packed_board before,
+                             Packed_board::Move move,
+                             int reward,
+                             Packed_board after,
+                             bool game_over)
+{
+    Trajectory_chunk& chunk = chunks_[filling_];
+    chunk.add(before, move, reward, after, game_over);
+    if (chunk.rows() >= chunk_rows) {
+        writer_.submit_(chunk);
+        // switch to the other chunk; normally the I/O thread finished
+        // with it long ago
+        filling_ ^= 1;
+        writer_.wait_written_(chunks_[filling_]);
+        chunks_[filling_].clear();
+    }
+}
+
+void
+Trajectory_writer::Sink::flush()
+{
+    if (chunks_[filling_].rows() > 0) {
+        writer_.submit_(chunks_[filling_]);
+        filling_ ^= 1;
+    }
+    for (Trajectory_chunk& chunk : chunks_) {
+        writer_.wait_written_(chunk);
+        chunk.clear();
+    }
+}
+
+///
+/// READER
+///
+
+Trajectory_reader::Trajectory_reader(std::string const& path)
+        : in_(path, std::ios::binary)
+{
+    if (not in_) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    char magic[8];
+    in_.read(magic, sizeof magic);
+    if (not in_ || std::memcmp(magic, header_magic, sizeof magic) != 0) {
+        throw std::runtime_error(path + " is not a trajectory file");
+    }
+
+    uint8_t trailer[trailer_size];
+    in_.seekg(-trailer_size, std::ios::end);
+    in_.read(reinterpret_cast<char*>(trailer), trailer_size);
+    if (not in_
+        || std::memcmp(trailer + 16, trailer_magic, sizeof trailer_magic) != 0)
+    {
+        throw std::runtime_error(path + " is incomplete (no footer)");
+    }
+    uint64_t count = decode_u64(trailer);
+    uint64_t footer_offset = decode_u64(trailer + 8);
+
+    std::vector<uint8_t> footer(count * index_entry_size);
+    in_.seekg(std::streamoff(footer_offset));
+    in_.read(reinterpret_cast<char*>(footer.data()),
+             std::streamsize(footer.size()));
+    if (not in_) {
+        throw std::runtime_error(path + " has a damaged footer");
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t const* p = footer.data() + i * index_entry_size;
+        index_.push_back({decode_u64(p), decode_u32(p + 8),
+                          decode_u32(p + 12)});
+    }
+}
+
+long long
+Trajectory_reader::rows() const
+{
+    long long total = 0;
+    for (Index_entry const& entry : index_) {
+        total += entry.rows;
+    }
+    return total;
+}
+
+void
+Trajectory_reader::read_chunk(size_t i, Trajectory_chunk& chunk)
+{
+    Index_entry const& entry = index_.at(i);
+    size_t n = entry.rows;
+    std::vector<uint8_t> bytes(16 * n + n + entry.reward_bytes);
+    in_.seekg(std::streamoff(entry.offset));
+    in_.read(reinterpret_cast<char*>(bytes.data()),
+             std::streamsize(bytes.size()));
+    if (not in_) {
+        throw std::runtime_error("trajectory chunk is truncated");
+    }
+
+    uint8_t const* p = bytes.data();
+    chunk.clear();
+    for (size_t r = 0; r < n; r++, p += 8) {
+        chunk.boards.push_back(decode_u64(p));
+    }
+    chunk.moves.assign(p, p + n);
+    p += n;
+    chunk.rewards.assign(p, p + entry.reward_bytes);
+    p += entry.reward_bytes;
+    for (size_t r = 0; r < n; r++, p += 8) {
+        chunk.next_boards.push_back(decode_u64(p));
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "board.hxx"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// streams self-play (board, move, reward, next board) tuples to a compact
+// column-oriented binary file for training pipelines.
+//
+// FILE FORMAT (all integers little-endian)
+//
+//   header:  8 bytes  "2048TRJ1"
+//   chunks:  one after another, each holding n rows stored column by column:
+//              n x 8 bytes   boards (Packed_board::bits)
+//              n x 1 byte    moves (Packed_board::Move in the low 2 bits;
+//                            bit 7 is set if the move ended the game)
+//              r bytes       rewards, n unsigned LEB128 varints
+//              n x 8 bytes   next boards (after the move and the spawn)
+//   footer:  one entry per chunk:
+//              8 bytes offset of the chunk, 4 bytes n, 4 bytes r
+//   trailer: 8 bytes number of chunks, 8 bytes offset of the footer,
+//            8 bytes "2048IDX1"
+//
+// chunks hold at most Trajectory_writer::chunk_rows rows. chunks from
+// different simulation threads are interleaved, but a game's rows are
+// always in order within the chunks of the thread that played it.
+
+/// CHUNKS
+// the rows of one chunk, already in column form
+struct Trajectory_chunk
+{
+    std::vector<uint64_t> boards;
+    std::vector<uint8_t> moves;
+    std::vector<uint8_t> rewards;
+    std::vector<uint64_t> next_boards;
+
+    // set while the writer thread owns this chunk
+    std::atomic<bool> in_flight {false};
+
+    // flag in a move byte marking the last move of a game
+    static const uint8_t game_over_flag = 0x80;
+
+    size_t rows() const { return moves.size(); }
+    void clear();
+    void reserve(size_t rows);
+    // appends one row
+    void add(Packed_board before, Packed_board::Move, int reward,
+             Packed_board after, bool game_over);
+    // decodes the rewards column (for readers)
+    std::vector<uint32_t> decode_rewards() const;
+};
+
+/// WRITER
+class Trajectory_writer
+{
+public:
+    // rows per chunk
+    static const size_t chunk_rows = 1 << 16;
+
+    // opens the file and starts the I/O thread. throws std::runtime_error
+    // if the file can't be opened.
+    explicit Trajectory_writer(std::string const& path);
+    // calls finish()
+    ~Trajectory_writer();
+
+    Trajectory_writer(Trajectory_writer const&) = delete;
+    Trajectory_writer& operator=(Trajectory_writer const&) = delete;
+
+    // a Sink is the per-thread front end of the writer. it fills one chunk
+    // while the I/O thread writes the other one, so a simulation thread
+    // only ever waits if the disk falls a whole chunk behind.
+    class Sink
+    {
+    public:
+        explicit Sink(Trajectory_writer&);
+        // calls flush()
+        ~Sink();
+
+        Sink(Sink const&) = delete;
+        Sink& operator=(Sink const&) = delete;
+
+        // records one move
+        void add(Packed_board before, Packed_board::Move, int reward,
+                 Packed_board after, bool game_over);
+        // hands the partly filled chunk to the writer and waits until
+        // both chunks have been written
+        void flush();
+
+    private:
+        Trajectory_writer& writer_;
+        Trajectory_chunk chunks_[2];
+        int filling_ = 0;
+    };
+
+    // writes the footer and closes the file, after every chunk handed over
+    // so far has been written. all Sinks must be flushed first.
+    void finish();
+
+    // number of rows written so far
+    long long rows_written() const { return rows_written_; }
+
+private:
+    struct Index_entry
+    {
+        uint64_t offset;
+        uint32_t rows;
+        uint32_t reward_bytes;
+    };
+
+    std::ofstream out_;
+    uint64_t offset_ = 0;
+    std::vector<Index_entry> index_;
+    std::atomic<long long> rows_written_ {0};
+
+    // chunks waiting for the I/O thread; guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable written_;
+    std::deque<Trajectory_chunk*> queue_;
+    bool stopping_ = false;
+    bool finished_ = false;
+    std::thread io_thread_;
+
+    // hands a full chunk to the I/O thread
+    void submit_(Trajectory_chunk&);
+    // waits until the I/O thread is done with a chunk
+    void wait_written_(Trajectory_chunk&);
+    // body of the I/O thread
+    void run_();
+    void write_chunk_(Trajectory_chunk const&);
+    void write_bytes_(void const*, size_t);
+    void write_u32_(uint32_t);
+    void write_u64_(uint64_t);
+    void write_u64s_(std::vector<uint64_t> const&);
+};
+
+/// READER
+// reads files written by Trajectory_writer, one chunk at a time
+class Trajectory_reader
+{
+public:
+    // reads the footer. throws std::runtime_error if the file can't be
+    // opened or is not a complete trajectory file.
+    explicit Trajectory_reader(std::string const& path);
+
+    size_t chunks() const { return index_.size(); }
+    // total number of rows in the file
+    long long rows() const;
+    // reads chunk i into chunk
+    void read_chunk(size_t i, Trajectory_chunk& chunk);
+
+private:
+    struct Index_entry
+    {
+        uint64_t offset;
+        uint32_t rows;
+        uint32_t reward_bytes;
+    };
+
+    std::ifstream in_;
+    std::vector<Index_entry> index_;
+};
@@ -1,14 +1,18 @@
 #include "view.hxx"
 #include <vector>
 #include <cmath>
+#include <functional>
+#include <iomanip>
+#include <sstream>
 #include <string>
 
 using Color = ge211::Color;
 using Font = ge211::Font;
 using Sprite_set = ge211::Sprite_set;
 
-View::View(Model const& model)
+View::View(Model const& model, Animation const& animation)
         : model_(model),
+          animation_(animation),
           line_sprite_vert(Dimensions(grid_line_thick,
                                       initial_window_dimensions()
                                       .height - top_margin),
@@ -23,19 +27,49 @@ View::View(Model const& model)
           border_sprite_hor(Dimensions(initial_window_dimensions().width,
                                        border_line_thick),
                             line_color),
-          score_text("SCORE:", score_font),
           new_game_button(new_game_button_dims, new_game_color),
-          new_game_text("NEW GAME", new_game_font),
           lost_screen(Dimensions(initial_window_dimensions().width,
                                       initial_window_dimensions().height - top_margin),
                        lost_screen_color),
           won_screen(Dimensions(initial_window_dimensions().width,
                                  initial_window_dimensions().height - top_margin),
                       won_screen_color),
-          lost_text("GAME OVER", game_over_font),
-          won_text("YOU WIN!", game_over_font),
-          game_instr_text("placeholder", game_instr_font)
+          overlay_background(Dimensions(initial_window_dimensions().width,
+                                        3 * 16 + 8),
+                             Color {0, 0, 0, 190})
 {
+    // the text is rendered by several threads at once, so each piece of
+    // it is a job
+    std::vector<std::function<void()>> text_jobs;
+
+    text_jobs.push_back([this] {
+        score_text = ge211::Text_sprite("SCORE:", score_font);
+    });
+    text_jobs.push_back([this] {
+        new_game_text = ge211::Text_sprite("NEW GAME", new_game_font);
+    });
+    text_jobs.push_back([this] {
+        lost_text = ge211::Text_sprite("GAME OVER", game_over_font);
+    });
+    text_jobs.push_back([this] {
+        won_text = ge211::Text_sprite("YOU WIN!", game_over_font);
+    });
+
+    // game instructions!
+    text_jobs.push_back([this] {
+        ge211::Text_sprite::Builder builder(game_instr_font);
+        // because the game instructions are bit long, we need to wrap it so that there is a margin between
+        // the instructions and the edge of the game window
+        builder.word_wrap(initial_window_dimensions().width - 20);
+        // the actual game instructions:
+        builder.add_message("HOW TO PLAY: Use your arrow keys to move the tiles. "
+                            "Tiles with the same number merge into one. "
+                            "Add them up to reach 2048!");
+        builder.color(Color {255, 230, 223});
+        // building the instructions sprite with our customizations from before:
+        game_instr_text.reconfigure(builder);
+    });
+
     // initialize block colors. index 0 = block 0.
     block_colors.push_back(Color {181, 165, 152}); // 0 - light brown/grey
     block_colors.push_back(Color {243, 207, 198}); // 2 - millennial pink
@@ -51,27 +85,105 @@ View::View(Model const& model)
     block_colors.push_back(Color {71, 123, 255}); // 2048 - blue
 
     // initialize block sprites and moving block sprites. index 0 = block 0.
+    // they are drawn as plain rectangles by the renderer, with no textures.
     for (int i = 0; i < 12; i++) {
-        block_sprites.push_back(ge211::Rectangle_sprite({sqlen, sqlen},
-                                                       block_colors[i]));
-        // note that moving blocks are smaller than normal blocks to fit within the grid lines
-        moving_block_sprites.push_back(ge211::Rectangle_sprite({sqlen - grid_line_thick,
-                                                                sqlen - grid_line_thick},
+        block_sprites.push_back(ge211::Solid_rectangle_sprite({sqlen, sqlen},
                                                              block_colors[i]));
+        // note that moving blocks are smaller than normal blocks to fit within the grid lines
+        moving_block_sprites.push_back(ge211::Solid_rectangle_sprite({sqlen - grid_line_thick,
+                                                                      sqlen - grid_line_thick},
+                                                                     block_colors[i]));
     }
 
     // initialize text sprites. index 0 = block 2, index 1 = block 4, etc.
+    block_text_sprites.resize(11);
     for (int j = 1; j < 12; j++) {
-        int val = pow(2, j);
-        block_text_sprites.push_back(ge211::Text_sprite(std::to_string(val),
-                                                      block_font));
+        text_jobs.push_back([this, j] {
+            int val = pow(2, j);
+            block_text_sprites[j - 1] = ge211::Text_sprite(std::to_string(val),
+                                                           block_font);
+        });
+    }
+
+    // only drawing the pixels is spread across cores; they are uploaded
+    // on this thread, when the controller warms them up
+    ge211::parallel_for(text_jobs.size(), [&](size_t i) {
+        text_jobs[i]();
+    });
+
+    // pack all the text onto shared sheets, so that the labels of a whole
+    // board of blocks are drawn with one texture rather than one each
+    ge211::Sprite_atlas atlas;
+    for (ge211::Text_sprite& text : block_text_sprites) {
+        atlas.add(text);
     }
+    atlas.add(score_text)
+         .add(new_game_text)
+         .add(lost_text)
+         .add(won_text)
+         .add(game_instr_text);
+    atlas.pack();
 }
 
 
 void
 View::draw(ge211::Sprite_set& set)
 {
+    GE211_TRACE_SCOPE("view", "draw");
+
+    // only look at the model and animation if one changed since the last
+    // rebuild; otherwise the same sprites go in the same places again
+    if (not render_list_valid || render_version != model_.get_version()
+        || render_animation_version != animation_.get_version())
+    {
+        build_render_list();
+        render_version = model_.get_version();
+        render_animation_version = animation_.get_version();
+        render_list_valid = true;
+    }
+
+    for (Placed_sprite const& placed : render_list) {
+        set.add_sprite(*placed.sprite, placed.pos, placed.z,
+                       placed.transform);
+    }
+}
+
+void
+View::place(ge211::Sprite const& sprite,
+            Position pos,
+            int z,
+            ge211::Transform const& transform)
+{
+    render_list.push_back({&sprite, pos, z, transform});
+}
+
+void
+View::place_scaled_block(Model::Position board_pos,
+                         int value,
+                         double scale,
+                         int z)
+{
+    // nothing to show until it has some size
+    if (scale <= 0) {
+        return;
+    }
+    int block_index = int(log2(value));
+    ge211::Transform transform = ge211::Transform::scale(scale);
+    place(block_sprites[block_index],
+          scale_about_block(board_to_screen(board_pos), board_pos, scale),
+          z, transform);
+    place(block_text_sprites[block_index - 1],
+          scale_about_block(board_to_screen_text(board_pos, value),
+                            board_pos, scale),
+          z + 1, transform);
+}
+
+void
+View::build_render_list()
+{
+    GE211_TRACE_SCOPE("view", "build_render_list");
+    render_list.clear();
+
     /// STACKING ORDER
     int base_z = 1; // instructions, new game, score, blocks
     int block_cover_z = base_z + 5; // empty block to cover the base block
@@ -79,32 +191,20 @@ View::draw(ge211::Sprite_set& set)
     int moving_block_z = lines_z + 5;
     int game_over_z = moving_block_z + 10;
 
-    // add game instructions!
-    ge211::Text_sprite::Builder builder(game_instr_font);
-    // because the game instructions are bit long, we need to wrap it so that there is a margin between
-    // the instructions and the edge of the game window
-    builder.word_wrap(initial_window_dimensions().width - 20);
-    // the actual game instructions:
-    builder.add_message("HOW TO PLAY: Use your arrow keys to move the tiles. "
-                        "Tiles with the same number merge into one. "
-                        "Add them up to reach 2048!");
-    builder.color(Color {255, 230, 223});
-    // building the instructions sprite with our customizations from before:
-    game_instr_text.reconfigure(builder);
-    set.add_sprite(game_instr_text, {10, 10}, 3);
+    // add game instructions! (built once, in the constructor)
+    place(game_instr_text, {10, 10}, 3);
 
     // add new game button and its text centered within the button
     Position ngb_pos = get_ngb_pos()[0];
-    set.add_sprite(new_game_button, ngb_pos, base_z);
+    place(new_game_button, ngb_pos, base_z);
     Position ngt_pos {ngb_pos.x + 8, ngb_pos.y - 1};
-    set.add_sprite(new_game_text, ngt_pos, base_z + 1);
+    place(new_game_text, ngt_pos, base_z + 1);
 
     // add score sprite
-    set.add_sprite(score_text, score_text_pos, base_z);
+    place(score_text, score_text_pos, base_z);
     // where the score value comes from the current score of the game
-    score_val = ge211::Text_sprite(std::to_string(model_.get_score()),
-                                   score_font);
-    set.add_sprite(score_val, score_val_pos, base_z);
+    score_val.reconfigure(std::to_string(model_.get_score()));
+    place(score_val, score_val_pos, base_z);
 
     // add block sprites
     // if the value of the board position is zero, add an empty block.
@@ -116,78 +216,93 @@ View::draw(ge211::Sprite_set& set)
             Position screen_pos = board_to_screen(board_pos);
             int value = model_.get_val(board_pos);
             if (value == 0) {
-                set.add_sprite(block_sprites[0], screen_pos, base_z);
+                place(block_sprites[0], screen_pos, base_z);
             } else {
                 double block_index = log2(value);
                 double text_index = block_index - 1;
-                set.add_sprite(block_sprites[int(block_index)], screen_pos,
-                               base_z);
+                place(block_sprites[int(block_index)], screen_pos,
+                      base_z);
                 Position screen_text_pos = board_to_screen_text(board_pos, value);
-                set.add_sprite(block_text_sprites[int(text_index)],
-                               screen_text_pos,
-                               base_z + 1);
+                place(block_text_sprites[int(text_index)],
+                      screen_text_pos,
+                      base_z + 1);
             }
         }
     }
 
-    // animation
-    for (int i = 0; i < int(model_.get_moving_blocks().size()); i++) {
-        // if blocks are moving, draw moving block, cover previous end block, cover newly
-        // spawned block.
-        if (model_.get_moving_blocks()[i].get_is_moving()) {
-            double block_index = log2(model_.get_moving_blocks()[i].get_val());
+    // animation: while blocks slide, draw them where they are on the way,
+    // cover the blocks they end up as, and cover the newly spawned block
+    if (animation_.is_sliding()) {
+        for (Animation::Slide const& slide : animation_.get_slides()) {
+            double block_index = log2(slide.value);
             double text_index = block_index - 1;
+            ge211::Posn<float> curr = animation_.slide_position(slide);
             // draw moving block + text
-            set.add_sprite(moving_block_sprites[int(block_index)],
-                           board_to_screen_a(model_.get_moving_blocks()[i].get_curr()),
-                           moving_block_z);
-            Position screen_text_pos = board_to_screen_text_a(model_.get_moving_blocks()[i].get_curr(),
-                                                              model_.get_moving_blocks()[i].get_val());
-            set.add_sprite(block_text_sprites[int(text_index)],
-                           screen_text_pos,
-                           moving_block_z + 1);
+            place(moving_block_sprites[int(block_index)],
+                  board_to_screen_a(curr),
+                  moving_block_z);
+            place(block_text_sprites[int(text_index)],
+                  board_to_screen_text_a(curr, slide.value),
+                  moving_block_z + 1);
             // cover new end block
-            if (model_.get_moving_blocks()[i].get_end_val() == 0) {
-                set.add_sprite(block_sprites[0],
-                               board_to_screen(model_.get_moving_blocks()[i].get_end().into<int>()),
-                               block_cover_z + 2);
+            if (slide.end_val == 0) {
+                place(block_sprites[0],
+                      board_to_screen(slide.to),
+                      block_cover_z + 2);
             } else {
-                set.add_sprite(block_sprites[int(block_index)],
-                               board_to_screen(model_.get_moving_blocks()[i].get_end().into<int>()),
-                               block_cover_z);
-                set.add_sprite(block_text_sprites[int(text_index)],
-                               board_to_screen_text(model_.get_moving_blocks()[i].get_end().into<int>(),
-                                                    model_.get_moving_blocks()[i].get_val()),
-                               block_cover_z + 1);
+                place(block_sprites[int(block_index)],
+                      board_to_screen(slide.to),
+                      block_cover_z);
+                place(block_text_sprites[int(text_index)],
+                      board_to_screen_text(slide.to, slide.value),
+                      block_cover_z + 1);
+            }
+        }
+        // cover newly spawned block
+        place(block_sprites[0],
+              board_to_screen(animation_.get_spawn_pos()),
+              block_cover_z);
+    } else if (animation_.is_animating()) {
+        // then merged blocks pop and the new block grows in, by drawing
+        // them scaled over the board
+        for (int i = 0; i < model_.get_size(); i++) {
+            for (int j = 0; j < model_.get_size(); j++) {
+                Position board_pos = Position(i, j);
+                double scale = animation_.block_scale(board_pos);
+                int value = model_.get_val(board_pos);
+                if (scale == 1 || value == 0) {
+                    continue;
+                }
+                if (scale < 1) {
+                    place(block_sprites[0], board_to_screen(board_pos),
+                          block_cover_z);
+                }
+                place_scaled_block(board_pos, value, scale, moving_block_z);
             }
-            // cover newly spawned block
-            set.add_sprite(block_sprites[0],
-                           board_to_screen(model_.get_new_spawn_pos()),
-                           block_cover_z);
         }
     }
 
     // vertical lines
     int vx = sqlen - 3;
     for (int i = 0; i < model_.get_size() - 1; i++) {
-        set.add_sprite(line_sprite_vert,
-                       Position(vx + i * sqlen, top_margin),
-                       lines_z);
+        place(line_sprite_vert,
+              Position(vx + i * sqlen, top_margin),
+              lines_z);
     }
     // horizontal lines
     int vy =  top_margin + sqlen - 3;
     for (int i = 0; i < model_.get_size() - 1; i++) {
-        set.add_sprite(line_sprite_hor,
-                       Position(0, vy + i * sqlen),
-                       lines_z);
+        place(line_sprite_hor,
+              Position(0, vy + i * sqlen),
+              lines_z);
     }
     // borders
-    set.add_sprite(border_sprite_vert, Position(0,top_margin), lines_z);
-    set.add_sprite(border_sprite_hor, Position(0,top_margin), lines_z);
-    set.add_sprite(border_sprite_vert,
-                   Position(initial_window_dimensions().width - 3,top_margin), lines_z);
-    set.add_sprite(border_sprite_hor,
-                   Position(0,initial_window_dimensions().height - 3), lines_z);
+    place(border_sprite_vert, Position(0,top_margin), lines_z);
+    place(border_sprite_hor, Position(0,top_margin), lines_z);
+    place(border_sprite_vert,
+          Position(initial_window_dimensions().width - 3,top_margin), lines_z);
+    place(border_sprite_hor,
+          Position(0,initial_window_dimensions().height - 3), lines_z);
 
     // game_over screen
     int lost_text_y = int(double(top_margin) * 1.8);
@@ -196,11 +311,11 @@ View::draw(ge211::Sprite_set& set)
     int won_text_x = int(double(initial_window_dimensions().width) * 0.25);
     // if you lost, display game over text
     if (model_.get_game_over() == 1) {
-        set.add_sprite(lost_screen, Position{0, top_margin}, game_over_z);
-        set.add_sprite(lost_text, Position{lost_text_x, lost_text_y}, game_over_z + 1);
+        place(lost_screen, Position{0, top_margin}, game_over_z);
+        place(lost_text, Position{lost_text_x, lost_text_y}, game_over_z + 1);
     } else if (model_.get_game_over() == 2) { // if you win, display you win text
-        set.add_sprite(won_screen, Position{0, top_margin}, game_over_z);
-        set.add_sprite(won_text, Position{won_text_x, won_text_y}, game_over_z + 1);
+        place(won_screen, Position{0, top_margin}, game_over_z);
+        place(won_text, Position{won_text_x, won_text_y}, game_over_z + 1);
     }
 }
 
@@ -262,6 +377,18 @@ View::board_to_screen_a(ge211::Posn<float> pos) const
     return ge211::Posn<float> {x, y}.into<int>();
 }
 
+View::Position
+View::scale_about_block(Position screen_pos,
+                        Model::Position board_pos,
+                        double scale) const
+{
+    Position top_left = board_to_screen(board_pos);
+    double center_x = top_left.x + sqlen / 2.0;
+    double center_y = top_left.y + sqlen / 2.0;
+    return {int(std::round(center_x + (screen_pos.x - center_x) * scale)),
+            int(std::round(center_y + (screen_pos.y - center_y) * scale))};
+}
+
 View::Position
 View::board_to_screen_text_a(ge211::Posn<float> pos, int val) const
 {
@@ -303,3 +430,81 @@ View::get_ngb_pos() const {
     r.push_back(bottom_right);
     return r;
 }
+
+std::vector<ge211::Sprite const*>
+View::textured_sprites() const
+{
+    // the text sprites share a few packed sheets, so preparing them
+    // uploads each sheet once
+    std::vector<ge211::Sprite const*> result;
+    for (ge211::Text_sprite const& text : block_text_sprites) {
+        result.push_back(&text);
+    }
+    result.push_back(&score_text);
+    result.push_back(&new_game_text);
+    result.push_back(&lost_text);
+    result.push_back(&won_text);
+    result.push_back(&game_instr_text);
+    return result;
+}
+
+void
+View::toggle_overlay()
+{
+    overlay_on = not overlay_on;
+    overlay_text_valid = false;
+}
+
+bool
+View::overlay_shown() const
+{
+    return overlay_on;
+}
+
+bool
+View::overlay_needs_stats() const
+{
+    // changing the text every frame would be unreadable anyway
+    return not overlay_text_valid
+           || overlay_age.elapsed_time().seconds() > 0.25;
+}
+
+void
+View::update_overlay(Overlay_stats const& stats)
+{
+    // the game doesn't idle while the overlay is shown, so this counts
+    // frames actually drawn: a low number means slow frames, not idle ones
+    // (or the window is in the background, where drawing is throttled)
+    std::ostringstream rates;
+    rates << std::fixed << std::setprecision(1)
+          << "drawn fps " << stats.fps << "  load " << std::setprecision(0)
+          << stats.load_percent << "%  sprites " << render_list.size();
+    overlay_rates.reconfigure(rates.str());
+
+    std::ostringstream times;
+    times << std::fixed << std::setprecision(1)
+          << "work ms  p50 " << stats.work_p50.seconds() * 1000
+          << "  p95 " << stats.work_p95.seconds() * 1000
+          << "  p99 " << stats.work_p99.seconds() * 1000;
+    overlay_times.reconfigure(times.str());
+
+    std::ostringstream memory;
+    memory << std::fixed << std::setprecision(1)
+           << "over budget " << stats.frames_over_budget
+           << "  textures " << stats.textures.count << ", "
+           << double(stats.textures.bytes) / (1024 * 1024) << " MB";
+    overlay_memory.reconfigure(memory.str());
+
+    overlay_age.reset();
+    overlay_text_valid = true;
+}
+
+void
+View::draw_overlay(ge211::Sprite_set& set)
+{
+    int const overlay_z = 100;
+    set.add_sprite(overlay_background, Position(0, 0), overlay_z);
+    set.add_sprite(overlay_rates, Position(6, 4), overlay_z + 1);
+    set.add_sprite(overlay_times, Position(6, 20), overlay_z + 1);
+    set.add_sprite(overlay_memory, Position(6, 36), overlay_z + 1);
+}
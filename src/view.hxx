@@ -1,5 +1,6 @@
 #pragma once
 
+#include "animation.hxx"
 #include "model.hxx"
 #include <vector>
 
@@ -13,8 +14,9 @@ public:
     using Font = ge211::Font;
 
     /// CONSTRUCTOR
-    // constructs a view that knows about the given model
-    explicit View(Model const&);
+    // constructs a view that shows the given model, as the given
+    // animation animates it
+    View(Model const&, Animation const&);
 
     /// DRAW
     void draw(ge211::Sprite_set& set);
@@ -30,9 +32,42 @@ public:
     // item 0 is top left corner, item 1 is bottom right corner
     std::vector<Position> get_ngb_pos() const;
 
+    /// WARM-UP
+    // every sprite with a texture, for the controller to have uploaded
+    // before it's first drawn, so that no frame (such as the first merge
+    // into a new block value) stalls on an upload
+    std::vector<ge211::Sprite const*> textured_sprites() const;
+
+    /// PERFORMANCE OVERLAY
+    // what the overlay shows; the controller gathers these from ge211
+    struct Overlay_stats
+    {
+        double fps;
+        double load_percent;
+        // time spent working per frame (everything but waiting)
+        ge211::Duration work_p50;
+        ge211::Duration work_p95;
+        ge211::Duration work_p99;
+        long frames_over_budget;
+        ge211::Texture_usage textures;
+    };
+    // shows the overlay if it's hidden, and hides it if it's shown
+    void toggle_overlay();
+    bool overlay_shown() const;
+    // whether it's time to give the overlay new numbers. they only change
+    // a few times a second, so the stats needn't be gathered every frame.
+    bool overlay_needs_stats() const;
+    // changes the overlay's text to show the given stats
+    void update_overlay(Overlay_stats const&);
+    // adds the overlay on top of everything draw() added. the text is drawn
+    // from a glyph atlas, so the overlay costs the same few sprites every
+    // frame and no new textures.
+    void draw_overlay(ge211::Sprite_set& set);
+
 private:
     /// TOP-LEVEL PRIVATE MEMBER VARIABLES
     Model const& model_;
+    Animation const& animation_;
     // (length of) the width and height of one block
     static const int sqlen = 69;
     // height of the top margin of the screen
@@ -58,6 +93,11 @@ private:
     // position (top-left corner) of the text that goes on the moving block.
     Position
     board_to_screen_text_a(ge211::Posn<float>, int) const;
+    // takes a screen position of something on the block at the given board
+    // position, returns where it goes when the block is scaled by the given
+    // amount about its center.
+    Position
+    scale_about_block(Position, Model::Position, double scale) const;
 
     /// BLOCKS
     // font used on all blocks
@@ -67,7 +107,7 @@ private:
     std::vector<Color> block_colors;
     // dictionary: key = block value, value = block sprite
     // index 0 holds block sprite for block value 0
-    std::vector<ge211::Rectangle_sprite> block_sprites;
+    std::vector<ge211::Solid_rectangle_sprite> block_sprites;
     // dictionary: key = block value, value = text sprite
     // index 0 holds text sprite for block value 2
     std::vector<ge211::Text_sprite> block_text_sprites;
@@ -75,7 +115,7 @@ private:
     /// ANIMATION
     // these blocks are slightly smaller to account for the grid lines covering
     // up part of the blocks.
-    std::vector<ge211::Rectangle_sprite> moving_block_sprites;
+    std::vector<ge211::Solid_rectangle_sprite> moving_block_sprites;
 
     /// GRID LINES
     // thickness of grid lines
@@ -86,10 +126,10 @@ private:
     // color of grid/border lines
     Color const line_color{117, 105, 95};
     // sprites for grid and border lines
-    ge211::Rectangle_sprite const line_sprite_vert;
-    ge211::Rectangle_sprite const line_sprite_hor;
-    ge211::Rectangle_sprite const border_sprite_vert;
-    ge211::Rectangle_sprite const border_sprite_hor;
+    ge211::Solid_rectangle_sprite const line_sprite_vert;
+    ge211::Solid_rectangle_sprite const line_sprite_hor;
+    ge211::Solid_rectangle_sprite const border_sprite_vert;
+    ge211::Solid_rectangle_sprite const border_sprite_hor;
 
     /// SCORE
     // the position of the word "SCORE: "
@@ -98,9 +138,10 @@ private:
     Position const score_val_pos{score_text_pos.x + 80, score_text_pos.y};
     // font of the score word and value
     Font const score_font{"sans.ttf", 20};
-    // sprites for "SCORE: " and score value
+    // sprites for "SCORE: " and score value. the value changes often, so
+    // it is drawn from the font's glyph atlas instead of its own texture.
     ge211::Text_sprite score_text;
-    ge211::Text_sprite score_val;
+    ge211::Glyph_text_sprite score_val{score_font};
 
     /// NEW GAME BUTTON
     // dimensions of the new game button
@@ -110,8 +151,8 @@ private:
     // font of the word "NEW GAME" on the button
     Font const new_game_font{"sans.ttf", 15};
     // sprites for "NEW GAME" word, and rectangle button
-    ge211::Rectangle_sprite const new_game_button;
-    ge211::Text_sprite const new_game_text;
+    ge211::Solid_rectangle_sprite const new_game_button;
+    ge211::Text_sprite new_game_text;
 
     /// GAME OVER
     // for lose: color of the semi-transparent screen that covers the board
@@ -123,14 +164,53 @@ private:
     // sprites for game over and you win screens, each composed of a
     // semi-transparent rectangle that covers the board and text that says
     // "GAME OVER" or "YOU WIN!"
-    ge211::Rectangle_sprite const lost_screen;
-    ge211::Rectangle_sprite const won_screen;
-    ge211::Text_sprite const lost_text;
-    ge211::Text_sprite const won_text;
+    ge211::Solid_rectangle_sprite const lost_screen;
+    ge211::Solid_rectangle_sprite const won_screen;
+    ge211::Text_sprite lost_text;
+    ge211::Text_sprite won_text;
 
     /// GAME INSTRUCTIONS
     // font of game instructions
     Font const game_instr_font{"sans.ttf", 13};
     // game instructions text sprite
     ge211::Text_sprite game_instr_text;
+
+    /// RENDER LIST
+    // one sprite placed by the last rebuild
+    struct Placed_sprite
+    {
+        ge211::Sprite const* sprite;
+        Position pos;
+        int z;
+        ge211::Transform transform;
+    };
+    // everything draw() adds to the sprite set, kept between frames. it is
+    // only rebuilt when the model's version changes; on other frames the
+    // same placements are added again without looking at the model.
+    std::vector<Placed_sprite> render_list;
+    // the model and animation versions render_list was built for
+    unsigned long render_version = 0;
+    unsigned long render_animation_version = 0;
+    bool render_list_valid = false;
+    // fills in render_list from the model and the animation
+    void build_render_list();
+    // adds one sprite to render_list
+    void place(ge211::Sprite const&, Position, int z,
+               ge211::Transform const& = ge211::Transform{});
+    // adds a block and its number to render_list, scaled about its center
+    // (scaling changes how the sprites are drawn, not the sprites)
+    void place_scaled_block(Model::Position, int value, double scale, int z);
+
+    /// PERFORMANCE OVERLAY (PRIVATE)
+    bool overlay_on = false;
+    Font const overlay_font{"sans.ttf", 12};
+    // dark box behind the text, across the top of the window
+    ge211::Solid_rectangle_sprite const overlay_background;
+    // one sprite per line of text
+    ge211::Glyph_text_sprite overlay_rates{overlay_font};
+    ge211::Glyph_text_sprite overlay_times{overlay_font};
+    ge211::Glyph_text_sprite overlay_memory{overlay_font};
+    // time since the text was last updated
+    ge211::Timer overlay_age;
+    bool overlay_text_valid = false;
 };
\ No newline at end of file
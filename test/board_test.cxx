@@ -0,0 +1,386 @@
+#include "arena.hxx"
+#include "board.hxx"
+#include "policy.hxx"
+#include "protocol.hxx"
+#include "simulation.hxx"
+#include "tournament.hxx"
+#include "trajectory.hxx"
+#include <cstdio>
+#include <sstream>
+#include <catch.hxx>
+
+using namespace ge211;
+
+using Move = Packed_board::Move;
+
+struct Test_access {
+    Model& model;
+    explicit Test_access(Model&);
+
+    // copies a packed board into the model, and resets the score
+    void load(Packed_board board)
+    {
+        for (int y = 0; y < model.size; y++) {
+            for (int x = 0; x < model.size; x++) {
+                model.board[y][x] = board.get_val({x, y});
+            }
+        }
+        model.score = 0;
+    }
+
+    // gets rid of the most recently spawned block
+    void despawn() {
+        Model::Position p = model.get_new_spawn_pos();
+        model.board[p.y][p.x] = 0;
+    }
+};
+
+Test_access::Test_access(Model& model)
+        : model(model)
+{ }
+
+TEST_CASE("packed board stores values")
+{
+    Packed_board board;
+    CHECK(board.count_empty() == 16);
+
+    board.set_exp({0, 0}, 1);
+    board.set_exp({3, 2}, 11);
+    CHECK(board.get_val({0, 0}) == 2);
+    CHECK(board.get_val({3, 2}) == 2048);
+    CHECK(board.get_val({1, 1}) == 0);
+    CHECK(board.max_exp() == 11);
+    CHECK(board.count_empty() == 14);
+
+    // transposing swaps x and y
+    CHECK(board.transposed().get_val({2, 3}) == 2048);
+    CHECK(board.transposed().transposed() == board);
+}
+
+TEST_CASE("packed board merges like Model")
+{
+    /* START
+     * [2][2][2][2]
+     * [4][2][2][ ]
+     * [ ][ ][ ][ ]
+     * [ ][ ][ ][ ]
+     *
+     * move left
+     *
+     * END
+     * [4][4][ ][ ]
+     * [4][4][ ][ ]
+     */
+    Packed_board board;
+    for (int x = 0; x < 4; x++) {
+        board.set_exp({x, 0}, 1);
+    }
+    board.set_exp({0, 1}, 2);
+    board.set_exp({1, 1}, 1);
+    board.set_exp({2, 1}, 1);
+
+    int score = 0;
+    CHECK(board.play_move(Packed_board::left, score));
+    CHECK(score == 12);
+    CHECK(board.get_val({0, 0}) == 4);
+    CHECK(board.get_val({1, 0}) == 4);
+    CHECK(board.get_val({2, 0}) == 0);
+    CHECK(board.get_val({0, 1}) == 4);
+    CHECK(board.get_val({1, 1}) == 4);
+
+    // moving into the wall changes nothing
+    Packed_board corner;
+    corner.set_exp({0, 0}, 3);
+    CHECK_FALSE(corner.play_move(Packed_board::left, score));
+    CHECK_FALSE(corner.play_move(Packed_board::up, score));
+    CHECK(corner.can_move(Packed_board::right));
+    CHECK(score == 12);
+}
+
+TEST_CASE("packed board agrees with Model on random boards")
+{
+    Model model(0);
+    Test_access t(model);
+    Packed_board::Rng rng(211);
+
+    for (int trial = 0; trial < 2000; trial++) {
+        // random board with small values and plenty of equal neighbours
+        Packed_board board;
+        for (int y = 0; y < 4; y++) {
+            for (int x = 0; x < 4; x++) {
+                board.set_exp({x, y}, rng.below(5));
+            }
+        }
+
+        for (int m = 0; m < Packed_board::num_moves; m++) {
+            t.load(board);
+            int reward = 0;
+            Packed_board expected = board.after_move(Move(m), reward);
+
+            model.play_move(Packed_board::to_direction(Move(m)));
+            if (expected != board) {
+                t.despawn();
+            }
+
+            CHECK(Packed_board::from_model(model) == expected);
+            CHECK(model.get_score() == reward);
+        }
+    }
+}
+
+TEST_CASE("packed board game over matches Model")
+{
+    // the nearly full board from Model::test_lose_game, after its spawn
+    Model model(1);
+    Packed_board board = Packed_board::from_model(model);
+    CHECK(board.game_over() == model.get_game_over());
+
+    Model win_model(2);
+    win_model.play_move({1, 0});
+    Packed_board won = Packed_board::from_model(win_model);
+    CHECK(won.game_over() == win_model.get_game_over());
+    CHECK(won.game_over() == 2);
+}
+
+TEST_CASE("search picks a legal move when every move scores below zero")
+{
+    // left doesn't move anything, and the big, jumbled tiles make every
+    // move that does score well below zero
+    int const exps[4][4] = {{14, 1, 13, 0},
+                            {3,  0, 0,  0},
+                            {1,  0, 0,  0},
+                            {12, 5, 4,  0}};
+    Packed_board board;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            board.set_exp({x, y}, exps[y][x]);
+        }
+    }
+    CHECK_FALSE(board.can_move(Packed_board::left));
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board next = board.after_move(Move(m), reward);
+        if (next != board) {
+            CHECK(Expectimax_policy::evaluate(next) < -1);
+        }
+    }
+
+    Packed_board::Rng rng(3);
+    for (int depth = 1; depth <= 2; depth++) {
+        Expectimax_policy policy(depth, Packed_board::Rules{});
+        CHECK(board.can_move(policy.choose(board, rng)));
+    }
+}
+
+TEST_CASE("spawning is deterministic from the seed")
+{
+    Packed_board::Rng rng1(7);
+    Packed_board::Rng rng2(7);
+    Packed_board a;
+    Packed_board b;
+    a.new_game(rng1);
+    b.new_game(rng2);
+    CHECK(a == b);
+    CHECK(a.count_empty() == 14);
+
+    // the first block of a new game is always a 2
+    Packed_board::Rules all_fours;
+    all_fours.four_percent = 100;
+    Packed_board c;
+    c.new_game(rng1, all_fours);
+    int twos = 0;
+    int fours = 0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            twos += c.get_val({x, y}) == 2;
+            fours += c.get_val({x, y}) == 4;
+        }
+    }
+    CHECK(twos == 1);
+    CHECK(fours == 1);
+}
+
+TEST_CASE("simulation merges per-thread statistics")
+{
+    Sim_options options;
+    options.games = 600;
+    options.policy = "greedy";
+    options.threads = 3;
+
+    Sim_result result = run_simulation(options);
+    CHECK(result.stats.games == 600);
+
+    long long total = 0;
+    for (int e = 0; e < Sim_stats::exps; e++) {
+        total += result.stats.max_tile[e];
+    }
+    CHECK(total == 600);
+
+    // the same seed gives the same games, whatever the thread count
+    options.threads = 1;
+    Sim_result again = run_simulation(options);
+    CHECK(again.stats.score_sum == result.stats.score_sum);
+    CHECK(again.stats.moves == result.stats.moves);
+
+    options.policy = "nonsense";
+    CHECK_THROWS(run_simulation(options));
+}
+
+TEST_CASE("tournament entrants see the same spawns")
+{
+    // a random policy and a copy of it with a different name play the
+    // same games, so their scores match game by game
+    Tournament_options options;
+    options.entrants = {"random", "greedy", "random"};
+    options.games = 100;
+    options.threads = 3;
+
+    Tournament_result result = run_tournament(options);
+    REQUIRE(result.entrants.size() == 3);
+    CHECK(result.entrants[0].scores == result.entrants[2].scores);
+    CHECK(result.entrants[0].stats.games == 100);
+    CHECK(result.entrants[1].stats.games == 100);
+
+    double mean, margin;
+    paired_difference(result.entrants[0], result.entrants[2], mean, margin);
+    CHECK(mean == 0);
+    CHECK(margin == 0);
+
+    // greedy beats random on average
+    CHECK(result.ranking()[0] == 1);
+
+    options.threads = 1;
+    Tournament_result again = run_tournament(options);
+    CHECK(again.entrants[1].scores == result.entrants[1].scores);
+
+    options.entrants = {"search:x"};
+    CHECK_THROWS(run_tournament(options));
+    options.entrants = {"learned:no_such_weights.bin"};
+    CHECK_THROWS(run_tournament(options));
+}
+
+TEST_CASE("trajectories round-trip through the columnar file")
+{
+    std::string path = "board_test_trajectories.bin";
+
+    Sim_options options;
+    options.games = 300;
+    options.policy = "random";
+    options.threads = 2;
+    options.trajectory_path = path;
+    Sim_result result = run_simulation(options);
+    CHECK(result.trajectory_rows == result.stats.moves);
+
+    Trajectory_reader reader(path);
+    CHECK(reader.rows() == result.stats.moves);
+
+    long long games_ended = 0;
+    long long reward_sum = 0;
+    Trajectory_chunk chunk;
+    for (size_t i = 0; i < reader.chunks(); i++) {
+        reader.read_chunk(i, chunk);
+        std::vector<uint32_t> rewards = chunk.decode_rewards();
+        REQUIRE(rewards.size() == chunk.rows());
+        for (size_t r = 0; r < chunk.rows(); r++) {
+            Packed_board before(chunk.boards[r]);
+            Packed_board::Move move = Packed_board::Move(chunk.moves[r] & 3);
+            if (chunk.moves[r] & Trajectory_chunk::game_over_flag) {
+                games_ended++;
+            }
+            // replaying the move gives the reward and, after one spawn,
+            // the next board
+            int reward = 0;
+            Packed_board moved = before.after_move(move, reward);
+            CHECK(reward == int(rewards[r]));
+            CHECK(moved.count_empty() - 1
+                  == Packed_board(chunk.next_boards[r]).count_empty());
+            reward_sum += reward;
+        }
+    }
+    CHECK(games_ended == result.stats.games);
+    CHECK(reward_sum == result.stats.score_sum);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("session arena plays like Packed_board and reuses slots")
+{
+    Session_arena arena;
+    Session_arena::Handle a = arena.create(1);
+    Session_arena::Handle b = arena.create(1);
+    CHECK(arena.size() == 2);
+
+    // the same seed gives the same game
+    CHECK(arena.get_board(a) == arena.get_board(b));
+    CHECK(arena.get_board(a).count_empty() == 14);
+
+    // moves follow the Packed_board rules, then spawn one block
+    Packed_board before = arena.get_board(a);
+    for (int m = 0; m < Packed_board::num_moves; m++) {
+        int reward = 0;
+        Packed_board expected = before.after_move(Packed_board::Move(m), reward);
+        if (expected != before) {
+            CHECK(arena.play_move(a, Packed_board::Move(m)));
+            CHECK(arena.get_board(a).count_empty()
+                  == expected.count_empty() - 1);
+            CHECK(arena.get_score(a) == reward);
+            break;
+        }
+    }
+    CHECK(arena.get_game_over(a) == 0);
+
+    // destroyed sessions free their slot, and old handles stop working
+    arena.destroy(a);
+    CHECK_FALSE(arena.valid(a));
+    CHECK_THROWS(arena.play_move(a, Packed_board::left));
+    Session_arena::Handle c = arena.create(5);
+    CHECK(c.slot == a.slot);
+    CHECK(arena.valid(c));
+    CHECK(arena.capacity() == 2);
+
+    // handles survive packing
+    CHECK(arena.valid(Session_arena::Handle::unpack(c.pack())));
+}
+
+TEST_CASE("bot protocol plays batches of moves")
+{
+    std::istringstream in("new 5\nLRUD\nl r u d\nstate\nfly\nquit\nL\n");
+    std::ostringstream out;
+    Bot_protocol(1).run(in, out);
+
+    // replay the same seed by hand
+    Packed_board::Rng rng(5);
+    Packed_board board;
+    board.new_game(rng);
+    int score = 0;
+    int moved = 0;
+    for (int m : {0, 1, 2, 3}) {
+        if (board.play_move(Packed_board::Move(m), score)) {
+            board.spawn(rng);
+            moved++;
+        }
+    }
+
+    std::istringstream lines(out.str());
+    std::string line;
+    std::vector<std::string> all;
+    while (std::getline(lines, line)) {
+        all.push_back(line);
+    }
+    // new, two batches, state, error; nothing after quit
+    REQUIRE(all.size() == 5);
+    CHECK(all[4] == "error unknown command");
+
+    std::istringstream first_batch(all[1]);
+    int got_moved, got_score, got_over;
+    first_batch >> got_moved >> got_score >> got_over;
+    CHECK(got_moved == moved);
+    CHECK(got_score == score);
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int val;
+            first_batch >> val;
+            CHECK(val == board.get_val({x, y}));
+        }
+    }
+}
@@ -1,3 +1,4 @@
+#include "animation.hxx"
 #include "model.hxx"
 #include <catch.hxx>
 
@@ -568,4 +569,136 @@ TEST_CASE("Spawn") {
     CHECK(t.count_blocks() == 0);
     model.play_move({1, 0});
     CHECK(t.count_blocks() == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Version changes with the game and the animation") {
+    Model model(0);
+    Animation animation;
+    Test_access t(model);
+
+    // nothing happens: the versions stay the same
+    unsigned long version = model.get_version();
+    unsigned long anim_version = animation.get_version();
+    animation.advance(0.1);
+    CHECK(model.get_version() == version);
+    CHECK(animation.get_version() == anim_version);
+
+    // a move changes the model's version once; every frame of its
+    // animation changes the animation's version
+    t.clear_board();
+    t.set_block({3, 0}, 2);
+    model.play_move({-1, 0});
+    CHECK(model.get_version() != version);
+    version = model.get_version();
+    animation.start_move(model);
+    CHECK(animation.get_version() != anim_version);
+    anim_version = animation.get_version();
+    animation.advance(0.01);
+    CHECK(animation.get_version() != anim_version);
+    CHECK(model.get_version() == version);
+
+    // once the animation is over, its version stops changing
+    animation.advance(1);
+    anim_version = animation.get_version();
+    animation.advance(0.1);
+    CHECK(animation.get_version() == anim_version);
+
+    model.new_game();
+    CHECK(model.get_version() != version);
+}
+
+TEST_CASE("Animation runs only for a move that moved something") {
+    Model model(0);
+    Animation animation;
+    Test_access t(model);
+
+    t.clear_board();
+    t.set_block({3, 0}, 2);
+    CHECK_FALSE(animation.is_animating());
+
+    model.play_move({-1, 0});
+    animation.start_move(model);
+    CHECK(animation.is_animating());
+    CHECK(animation.is_sliding());
+    animation.advance(0.01);
+    CHECK(animation.is_animating());
+
+    animation.advance(Animation::slide_seconds + Animation::spawn_seconds);
+    CHECK_FALSE(animation.is_animating());
+
+    // a move that changes nothing doesn't start an animation
+    t.clear_board();
+    t.set_block({0, 0}, 2);
+    model.play_move({-1, 0});
+    animation.start_move(model);
+    CHECK_FALSE(animation.is_animating());
+}
+
+TEST_CASE("Sliding depends only on the time since the move") {
+    Model model(0);
+    Animation one_step, many_steps;
+    Test_access t(model);
+
+    t.clear_board();
+    t.set_block({3, 0}, 2);
+    model.play_move({-1, 0});
+    one_step.start_move(model);
+    many_steps.start_move(model);
+    CHECK(one_step.get_slides().size() == 1);
+
+    Animation::Slide slide = one_step.get_slides()[0];
+    CHECK(slide.from == Model::Position{3, 0});
+    CHECK(slide.to == Model::Position{0, 0});
+    CHECK(one_step.slide_position(slide).x == 3);
+
+    // one big frame ends up in the same place as many small ones
+    one_step.advance(0.05);
+    for (int i = 0; i < 10; i++) {
+        many_steps.advance(0.005);
+    }
+    float x = one_step.slide_position(slide).x;
+    CHECK(x < 3);
+    CHECK(x > 0);
+    CHECK(many_steps.slide_position(slide).x == Catch::Approx(x));
+
+    // a frame far longer than the slide stops at the end, not past it
+    one_step.advance(10);
+    CHECK(one_step.slide_position(slide).x == 0);
+    CHECK_FALSE(one_step.is_sliding());
+}
+
+TEST_CASE("Merged blocks pop and new blocks grow after sliding") {
+    Model model(0);
+    Animation animation;
+    Test_access t(model);
+
+    t.clear_board();
+    t.set_block({2, 0}, 2);
+    t.set_block({3, 0}, 2);
+    model.play_move({-1, 0});
+    animation.start_move(model);
+
+    Model::Position merged {0, 0};
+    Model::Position spawned = animation.get_spawn_pos();
+    CHECK(model.get_val(merged) == 4);
+
+    // nothing is scaled while blocks slide
+    CHECK(animation.block_scale(merged) == 1);
+    CHECK(animation.block_scale(spawned) == 1);
+
+    // then the merged block gets bigger and the new block starts small
+    animation.advance(Animation::slide_seconds + 0.05);
+    CHECK(animation.block_scale(merged) > 1);
+    CHECK(animation.block_scale(spawned) < 1);
+    // and nothing else is scaled
+    Model::Position other = spawned == Model::Position{3, 3}
+                            ? Model::Position{2, 3}
+                            : Model::Position{3, 3};
+    CHECK(animation.block_scale(other) == 1);
+
+    // finishing jumps to the end
+    animation.finish();
+    CHECK_FALSE(animation.is_animating());
+    CHECK(animation.block_scale(merged) == 1);
+    CHECK(animation.block_scale(spawned) == 1);
+}
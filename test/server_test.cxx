@@ -0,0 +1,179 @@
+#include "server.hxx"
+#include <catch.hxx>
+#include <cstring>
+#include <thread>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace server_protocol;
+
+namespace {
+
+// connects to the server's socket, retrying while it starts up
+int
+connect_to(std::string const& path)
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr*) &address, sizeof address) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// sends requests in one write and reads back one response for each
+std::vector<Response>
+round_trip(int fd, std::vector<Request> const& requests)
+{
+    std::vector<uint8_t> out(requests.size() * request_size);
+    for (size_t i = 0; i < requests.size(); i++) {
+        encode(requests[i], out.data() + i * request_size);
+    }
+    CHECK(write(fd, out.data(), out.size()) == ssize_t(out.size()));
+
+    std::vector<uint8_t> in(requests.size() * response_size);
+    size_t got = 0;
+    while (got < in.size()) {
+        ssize_t n = read(fd, in.data() + got, in.size() - got);
+        REQUIRE(n > 0);
+        got += size_t(n);
+    }
+
+    std::vector<Response> responses;
+    for (size_t i = 0; i < requests.size(); i++) {
+        responses.push_back(decode_response(in.data() + i * response_size));
+    }
+    return responses;
+}
+
+// seconds of CPU time this process has used so far, on all threads
+double
+cpu_seconds()
+{
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+           + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+}  // end anonymous namespace
+
+TEST_CASE("protocol frames round-trip")
+{
+    Response response;
+    response.status = unknown_session;
+    response.moved = 1;
+    response.score = 123456;
+    response.board = 0x0123456789ABCDEFull;
+    response.session = 42;
+    uint8_t bytes[response_size];
+    encode(response, bytes);
+    Response back = decode_response(bytes);
+    CHECK(back.status == response.status);
+    CHECK(back.moved == 1);
+    CHECK(back.score == 123456);
+    CHECK(back.board == response.board);
+    CHECK(back.session == 42);
+}
+
+TEST_CASE("server plays games over the socket")
+{
+    std::string path = "server_test.sock";
+    Game_server server(path, 2, 1);
+    std::thread runner([&] { server.run(); });
+
+    int fd = connect_to(path);
+    REQUIRE(fd >= 0);
+
+    Response created = round_trip(fd, {{new_game, 0, 99}})[0];
+    CHECK(created.status == ok);
+    CHECK(Packed_board(created.board).count_empty() == 14);
+
+    // pipelined: four moves and a state query in one write
+    std::vector<Request> batch;
+    for (uint8_t m = 0; m < Packed_board::num_moves; m++) {
+        batch.push_back({move, m, created.session});
+    }
+    batch.push_back({get_state, 0, created.session});
+    std::vector<Response> replies = round_trip(fd, batch);
+    int moved = 0;
+    for (size_t i = 0; i < 4; i++) {
+        CHECK(replies[i].status == ok);
+        moved += replies[i].moved;
+    }
+    CHECK(moved > 0);
+    CHECK(replies[4].board == replies[3].board);
+    CHECK(server.sessions() == 1);
+
+    // ending the game forgets the session
+    CHECK(round_trip(fd, {{end_game, 0, created.session}})[0].status == ok);
+    CHECK(round_trip(fd, {{get_state, 0, created.session}})[0].status
+          == unknown_session);
+    CHECK(round_trip(fd, {{7, 0, 0}})[0].status == bad_request);
+    CHECK(server.sessions() == 0);
+
+    close(fd);
+    server.stop();
+    runner.join();
+}
+
+TEST_CASE("server keeps serving when it runs out of descriptors")
+{
+    std::string path = "server_test_fds.sock";
+    Game_server server(path, 2, 1);
+    std::thread runner([&] { server.run(); });
+
+    int fd = connect_to(path);
+    REQUIRE(fd >= 0);
+    Response created = round_trip(fd, {{new_game, 0, 99}})[0];
+    CHECK(created.status == ok);
+
+    // a client socket, made while there are still descriptors for it
+    int late_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(late_fd >= 0);
+
+    // every descriptor below the lowest free one is in use, so with that as
+    // the limit the server can't accept anything more
+    rlimit old_limit {};
+    REQUIRE(getrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    int lowest_free = dup(0);
+    REQUIRE(lowest_free >= 0);
+    close(lowest_free);
+    rlimit low_limit = old_limit;
+    low_limit.rlim_cur = rlim_t(lowest_free);
+    REQUIRE(setrlimit(RLIMIT_NOFILE, &low_limit) == 0);
+
+    // the new connection waits in the backlog, and the server doesn't spin
+    // on it
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    CHECK(connect(late_fd, (sockaddr*) &address, sizeof address) == 0);
+    double cpu_before = cpu_seconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(cpu_seconds() - cpu_before < 0.15);
+
+    // the existing connection is still answered
+    Response state = round_trip(fd, {{get_state, 0, created.session}})[0];
+    CHECK(state.status == ok);
+    CHECK(state.board == created.board);
+
+    // and once there are descriptors again, the waiting client is served
+    REQUIRE(setrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    CHECK(round_trip(late_fd, {{new_game, 0, 7}})[0].status == ok);
+    CHECK(server.sessions() == 2);
+
+    close(late_fd);
+    close(fd);
+    server.stop();
+    runner.join();
+}